@@ -2,9 +2,11 @@
 #ifndef FS_IPH_H
 #define FS_IPC_H
 
-#define MaxParamSize sizeof(int) * 4
-const int regq_key = 12345;
-const int regq_permissions = 0666;
+#define MaxParamSize sizeof(long long) * 3
+static const int regq_key = 12345;
+static const int regq_permissions = 0666;
+// mtype of the replies sent back on the process' queue
+static const long return_mtype = 100;
 
 struct RequestBuf
 {
@@ -26,6 +28,26 @@ enum CommandType
     CommandType_List,
     CommandType_Exit,
     CommandType_ErrorInfo,
+    CommandType_SeekData,
+    CommandType_SeekHole,
+    CommandType_Truncate,
+    CommandType_Preallocate,
+    CommandType_Clone,
+    CommandType_ListPlus,
+    CommandType_ListPage,
+    CommandType_Rename,
+    CommandType_CreateMany,
+    CommandType_PRead,
+    CommandType_PWrite,
+    CommandType_Seek,
+    CommandType_OpenAt,
+    CommandType_CreateAt,
+    CommandType_RemoveAt,
+    CommandType_Stat,
+    CommandType_Fstat,
+    CommandType_GetHandle,
+    CommandType_OpenByHandle,
+    CommandType_Append,
 };
 
 struct CommandBuf
@@ -55,6 +77,8 @@ struct ReadParameters
     int f_idx;
     int size;
     int buf_shmid;
+    // only used by CommandType_PRead, the others continue at the descriptor's offset
+    long long offset;
 };
 
 struct WriteParameters
@@ -62,6 +86,8 @@ struct WriteParameters
     int f_idx;
     int size;
     int buf_shmid;
+    // only used by CommandType_PWrite, the others continue at the descriptor's offset
+    long long offset;
 };
 
 struct CreateParameters
@@ -76,6 +102,27 @@ struct RemoveParameters
     int path_shmid;
 };
 
+// the *At commands resolve a relative path from the opened directory dir_f_idx
+struct OpenAtParameters
+{
+    int dir_f_idx;
+    int path_shmid;
+};
+
+struct CreateAtParameters
+{
+    int dir_f_idx;
+    char etype;
+    int path_shmid;
+    int permissions;
+};
+
+struct RemoveAtParameters
+{
+    int dir_f_idx;
+    int path_shmid;
+};
+
 struct ListParameters
 {
     int f_idx;
@@ -83,6 +130,134 @@ struct ListParameters
     int listing_shmid;
 };
 
+// record FS_ListPlus returns for every entry, followed by the entry's name (name_len bytes, not null terminated)
+// rec_len is the distance to the next record, records are padded to 8 bytes
+struct ListPlusRecord
+{
+    unsigned short rec_len;
+    char type; // 'D' or 'F'
+    unsigned char name_len;
+    int owner;
+    int permissions;
+    unsigned int size;
+    long long created;
+    long long modified;
+    long long accessed;
+};
+
+// start of the segment shared for FS_ListPage, followed by the page's ListPlusRecords
+// the client sets the cookie to where the page starts, the server replaces it with where the next one does
+struct ListPageHeader
+{
+    long long cookie;
+};
+
+struct SeekParameters
+{
+    int f_idx;
+    int offset;
+};
+
+struct TruncateParameters
+{
+    int f_idx;
+    int size;
+};
+
+struct PreallocateParameters
+{
+    int f_idx;
+    int offset;
+    int size;
+};
+
+struct CloneParameters
+{
+    int src_path_shmid;
+    int dst_path_shmid;
+};
+
+struct RenameParameters
+{
+    int old_path_shmid;
+    int new_path_shmid;
+};
+
+struct CreateManyParameters
+{
+    int path_shmid;
+    int entries_shmid;
+    int count;
+};
+
+// an element to create with FS_CreateMany, followed by its name (not null terminated)
+// rec_len is the distance to the next record, records are padded to a multiple of 8 bytes
+struct CreateManyRecord
+{
+    unsigned short rec_len;
+    char type; // 'D' or 'F'
+    unsigned char name_len;
+    int permissions;
+    int result; // set to 1 by the server if the element was created
+};
+
+// whence is SEEK_SET, SEEK_CUR or SEEK_END
+struct SeekOffsetParameters
+{
+    int f_idx;
+    int whence;
+    long long offset;
+};
+
+// the segment holds the path on the way in and a StatRecord on the way out
+struct StatParameters
+{
+    int shmid;
+};
+
+struct FstatParameters
+{
+    int f_idx;
+    int shmid;
+};
+
+// what FS_Stat/FS_Fstat fill in
+struct StatRecord
+{
+    char type; // 'D' or 'F'
+    int owner;
+    int permissions;
+    unsigned int size;
+    long long created;
+    long long modified;
+    long long accessed;
+};
+
+struct GetHandleParameters
+{
+    int f_idx;
+    int shmid; // FileHandle on the way out
+};
+
+// names a file by its inode instead of its path, see FS_GetHandle
+struct FileHandle
+{
+    unsigned int inode_block;
+    unsigned int generation;
+};
+
+struct OpenByHandleParameters
+{
+    unsigned int inode_block;
+    unsigned int generation;
+};
+
+struct ErrorInfoParameters
+{
+    int buf_shmid;
+    int buf_size;
+};
+
 struct ExitParameters
 {
     // literally empty
@@ -94,9 +269,12 @@ struct ExitParameters
 
 namespace FSIPC
 {
-    constexpr int MaxParamSize = sizeof(int) * 4;
+    constexpr int MaxParamSize = sizeof(long long) * 3;
     constexpr int regq_key = 12345;
     constexpr int regq_permissions = 0666;
+    // mtype of the replies sent back on a process' queue
+    // every command type must be smaller than this
+    constexpr long return_mtype = 100;
 
     struct RequestBuf
     {
@@ -117,7 +295,27 @@ namespace FSIPC
         Remove,
         List,
         Exit,
-        ErrorInfo
+        ErrorInfo,
+        SeekData,
+        SeekHole,
+        Truncate,
+        Preallocate,
+        Clone,
+        ListPlus,
+        ListPage,
+        Rename,
+        CreateMany,
+        PRead,
+        PWrite,
+        Seek,
+        OpenAt,
+        CreateAt,
+        RemoveAt,
+        Stat,
+        Fstat,
+        GetHandle,
+        OpenByHandle,
+        Append,
     };
 
     struct CommandBuf
@@ -147,6 +345,8 @@ namespace FSIPC
         int f_idx;
         int size;
         int buf_shmid;
+        // only used by Type::PRead, the others continue at the descriptor's offset
+        long long offset;
     };
 
     struct WriteParameters
@@ -154,6 +354,8 @@ namespace FSIPC
         int f_idx;
         int size;
         int buf_shmid;
+        // only used by Type::PWrite, the others continue at the descriptor's offset
+        long long offset;
     };
 
     struct CreateParameters
@@ -168,6 +370,27 @@ namespace FSIPC
         int path_shmid;
     };
 
+    // the *At commands resolve a relative path from the opened directory dir_f_idx
+    struct OpenAtParameters
+    {
+        int dir_f_idx;
+        int path_shmid;
+    };
+
+    struct CreateAtParameters
+    {
+        int dir_f_idx;
+        char etype;
+        int path_shmid;
+        int permissions;
+    };
+
+    struct RemoveAtParameters
+    {
+        int dir_f_idx;
+        int path_shmid;
+    };
+
     struct ListParameters
     {
         int f_idx;
@@ -175,6 +398,128 @@ namespace FSIPC
         int listing_shmid;
     };
 
+    // record ListPlus returns for every entry, followed by the entry's name (name_len bytes, not null terminated)
+    // rec_len is the distance to the next record, records are padded to 8 bytes
+    struct ListPlusRecord
+    {
+        unsigned short rec_len;
+        char type; // 'D' or 'F'
+        unsigned char name_len;
+        int owner;
+        int permissions;
+        unsigned int size;
+        long long created;
+        long long modified;
+        long long accessed;
+    };
+
+    // start of the segment shared for ListPage, followed by the page's ListPlusRecords
+    // the client sets the cookie to where the page starts, the server replaces it with where the next one does
+    struct ListPageHeader
+    {
+        long long cookie;
+    };
+
+    struct SeekParameters
+    {
+        int f_idx;
+        int offset;
+    };
+
+    struct TruncateParameters
+    {
+        int f_idx;
+        int size;
+    };
+
+    struct PreallocateParameters
+    {
+        int f_idx;
+        int offset;
+        int size;
+    };
+
+    struct CloneParameters
+    {
+        int src_path_shmid;
+        int dst_path_shmid;
+    };
+
+    struct RenameParameters
+    {
+        int old_path_shmid;
+        int new_path_shmid;
+    };
+
+    struct CreateManyParameters
+    {
+        int path_shmid;
+        int entries_shmid;
+        int count;
+    };
+
+    // an element to create with CreateMany, followed by its name (not null terminated)
+    // rec_len is the distance to the next record, records are padded to a multiple of 8 bytes
+    struct CreateManyRecord
+    {
+        unsigned short rec_len;
+        char type; // 'D' or 'F'
+        unsigned char name_len;
+        int permissions;
+        int result; // set to 1 if the element was created
+    };
+
+    // whence is SEEK_SET, SEEK_CUR or SEEK_END
+    struct SeekOffsetParameters
+    {
+        int f_idx;
+        int whence;
+        long long offset;
+    };
+
+    // the segment holds the path on the way in and a StatRecord on the way out
+    struct StatParameters
+    {
+        int shmid;
+    };
+
+    struct FstatParameters
+    {
+        int f_idx;
+        int shmid;
+    };
+
+    // what FS_Stat/FS_Fstat fill in
+    struct StatRecord
+    {
+        char type; // 'D' or 'F'
+        int owner;
+        int permissions;
+        unsigned int size;
+        long long created;
+        long long modified;
+        long long accessed;
+    };
+
+    struct GetHandleParameters
+    {
+        int f_idx;
+        int shmid; // FileHandle on the way out
+    };
+
+    // names a file by its inode instead of its path, see FS_GetHandle
+    struct FileHandle
+    {
+        unsigned int inode_block;
+        unsigned int generation;
+    };
+
+    struct OpenByHandleParameters
+    {
+        unsigned int inode_block;
+        unsigned int generation;
+    };
+
     struct ErrorInfoParameters
     {
         int buf_shmid;
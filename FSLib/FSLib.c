@@ -17,6 +17,14 @@ key_t shm_key;
 
 static int GetNewSHM(int size, int permissions);
 static int GetReturnValue(int shmid);
+static int CreateManyNameLength(const char* name);
+// send a read/write of the given command type and wait for the reply
+static int ReadAt(long mtype, int fd, char* buf, int size, long long offset);
+static int WriteAt(long mtype, int fd, const char* buf, int size, long long offset);
+// put path in a new shared segment, returns its id
+static int NewPathSHM(const char* path);
+// send a command whose only shared segment is shmid, wait for the reply and remove the segment
+static int SendPathCommand(long mtype, const void* params, int size, int shmid);
 
 void FS_Init()
 {
@@ -101,7 +109,7 @@ int FS_Create(const char* path, char type, int permissions)
 
     // wait for response
     struct ReturnBuf rbuf;
-    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), 10, 0) == -1)
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
     {
         perror("[Create 3] msgrcv");
         shmctl(shmid, IPC_RMID, NULL);
@@ -140,7 +148,7 @@ int FS_Remove(const char* path)
     }
 
     struct ReturnBuf rbuf;
-    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), 10, 0) == -1)
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
     {
         perror("[Remove 3] msgrcv");
         shmctl(shmid, IPC_RMID, NULL);
@@ -150,6 +158,199 @@ int FS_Remove(const char* path)
     return rbuf.retval;
 }
 
+int FS_Clone(const char* src_path, const char* dst_path)
+{
+    struct CommandBuf cbuf = { .mtype = CommandType_Clone };
+
+    const int src_shmid = GetNewSHM(strlen(src_path) + 1, 0666);
+    if(src_shmid == -1)
+    {
+        perror("[Clone 1] shmget");
+        exit(EXIT_FAILURE);
+    }
+    const int dst_shmid = GetNewSHM(strlen(dst_path) + 1, 0666);
+    if(dst_shmid == -1)
+    {
+        perror("[Clone 2] shmget");
+        shmctl(src_shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    char* shm = shmat(src_shmid, NULL, 0);
+    strcpy(shm, src_path);
+    shmdt(shm);
+    shm = shmat(dst_shmid, NULL, 0);
+    strcpy(shm, dst_path);
+    shmdt(shm);
+
+    struct CloneParameters params = {
+        .src_path_shmid = src_shmid,
+        .dst_path_shmid = dst_shmid
+    };
+
+    memcpy(cbuf.mtext, &params, sizeof(params));
+
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[Clone 3] msgsnd");
+        shmctl(src_shmid, IPC_RMID, NULL);
+        shmctl(dst_shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    struct ReturnBuf rbuf;
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
+    {
+        perror("[Clone 4] msgrcv");
+        shmctl(src_shmid, IPC_RMID, NULL);
+        shmctl(dst_shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+    shmctl(src_shmid, IPC_RMID, NULL);
+    shmctl(dst_shmid, IPC_RMID, NULL);
+    return rbuf.retval;
+}
+
+int FS_CreateMany(const char* dir_path, int count, const char** names, const char* types, 
+    const int* permissions, int* results)
+{
+    struct CommandBuf cbuf = { .mtype = CommandType_CreateMany };
+
+    int entries_size = 0;
+    for(int i = 0; i < count; i++)
+        entries_size += (sizeof(struct CreateManyRecord) + CreateManyNameLength(names[i]) + 7) / 8 * 8;
+
+    const int path_shmid = GetNewSHM(strlen(dir_path) + 1, 0666);
+    if(path_shmid == -1)
+    {
+        perror("[CreateMany 1] shmget");
+        exit(EXIT_FAILURE);
+    }
+    const int entries_shmid = GetNewSHM(entries_size > 0 ? entries_size : 1, 0666);
+    if(entries_shmid == -1)
+    {
+        perror("[CreateMany 2] shmget");
+        shmctl(path_shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    char* shm = shmat(path_shmid, NULL, 0);
+    strcpy(shm, dir_path);
+    shmdt(shm);
+
+    shm = shmat(entries_shmid, NULL, 0);
+    int pos = 0;
+    for(int i = 0; i < count; i++)
+    {
+        const int name_len = CreateManyNameLength(names[i]);
+        struct CreateManyRecord rec = {
+            .rec_len = (sizeof(struct CreateManyRecord) + name_len + 7) / 8 * 8,
+            .type = types[i],
+            .name_len = name_len,
+            .permissions = permissions[i],
+            .result = 0
+        };
+        memcpy(shm + pos, &rec, sizeof(rec));
+        memcpy(shm + pos + sizeof(rec), names[i], name_len);
+        pos += rec.rec_len;
+    }
+
+    struct CreateManyParameters params = {
+        .path_shmid = path_shmid,
+        .entries_shmid = entries_shmid,
+        .count = count
+    };
+
+    memcpy(cbuf.mtext, &params, sizeof(params));
+
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[CreateMany 3] msgsnd");
+        shmdt(shm);
+        shmctl(path_shmid, IPC_RMID, NULL);
+        shmctl(entries_shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    struct ReturnBuf rbuf;
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
+    {
+        perror("[CreateMany 4] msgrcv");
+        shmdt(shm);
+        shmctl(path_shmid, IPC_RMID, NULL);
+        shmctl(entries_shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    pos = 0;
+    for(int i = 0; i < count; i++)
+    {
+        struct CreateManyRecord rec;
+        memcpy(&rec, shm + pos, sizeof(rec));
+        if(results != NULL)
+            results[i] = rec.result;
+        pos += rec.rec_len;
+    }
+
+    shmdt(shm);
+    shmctl(path_shmid, IPC_RMID, NULL);
+    shmctl(entries_shmid, IPC_RMID, NULL);
+    return rbuf.retval;
+}
+
+int FS_Rename(const char* old_path, const char* new_path)
+{
+    struct CommandBuf cbuf = { .mtype = CommandType_Rename };
+
+    const int old_shmid = GetNewSHM(strlen(old_path) + 1, 0666);
+    if(old_shmid == -1)
+    {
+        perror("[Rename 1] shmget");
+        exit(EXIT_FAILURE);
+    }
+    const int new_shmid = GetNewSHM(strlen(new_path) + 1, 0666);
+    if(new_shmid == -1)
+    {
+        perror("[Rename 2] shmget");
+        shmctl(old_shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    char* shm = shmat(old_shmid, NULL, 0);
+    strcpy(shm, old_path);
+    shmdt(shm);
+    shm = shmat(new_shmid, NULL, 0);
+    strcpy(shm, new_path);
+    shmdt(shm);
+
+    struct RenameParameters params = {
+        .old_path_shmid = old_shmid,
+        .new_path_shmid = new_shmid
+    };
+
+    memcpy(cbuf.mtext, &params, sizeof(params));
+
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[Rename 3] msgsnd");
+        shmctl(old_shmid, IPC_RMID, NULL);
+        shmctl(new_shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    struct ReturnBuf rbuf;
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
+    {
+        perror("[Rename 4] msgrcv");
+        shmctl(old_shmid, IPC_RMID, NULL);
+        shmctl(new_shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+    shmctl(old_shmid, IPC_RMID, NULL);
+    shmctl(new_shmid, IPC_RMID, NULL);
+    return rbuf.retval;
+}
+
 int FS_Open(const char* path)
 {
 	struct CommandBuf cbuf = { .mtype = CommandType_Open };
@@ -179,7 +380,7 @@ int FS_Open(const char* path)
     }
 
     struct ReturnBuf rbuf;
-    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), 10, 0) == -1)
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
     {
         perror("[Create 3] msgrcv");
         shmctl(shmid, IPC_RMID, NULL);
@@ -201,7 +402,7 @@ int FS_Close(int fd)
     }
 
     struct ReturnBuf rbuf;
-    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), 10, 0) == -1)
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
     {
         perror("[Close 2] msgrcv");
         exit(EXIT_FAILURE);
@@ -211,19 +412,208 @@ int FS_Close(int fd)
 
 int FS_Read(int fd, char* buf, int size)
 {
-	struct CommandBuf cbuf = { .mtype = CommandType_Read };
+    return ReadAt(CommandType_Read, fd, buf, size, 0);
+}
+
+int FS_Write(int fd, char* buf, int size)
+{
+    return WriteAt(CommandType_Write, fd, buf, size, 0);
+}
+
+int FS_PRead(int fd, char* buf, int size, long long offset)
+{
+    return ReadAt(CommandType_PRead, fd, buf, size, offset);
+}
+
+int FS_PWrite(int fd, const char* buf, int size, long long offset)
+{
+    return WriteAt(CommandType_PWrite, fd, buf, size, offset);
+}
+
+int FS_Append(int fd, const char* buf, int size)
+{
+    return WriteAt(CommandType_Append, fd, buf, size, 0);
+}
+
+int FS_OpenAt(int dirfd, const char* path)
+{
+    const int shmid = NewPathSHM(path);
+    struct OpenAtParameters params = { .dir_f_idx = dirfd, .path_shmid = shmid };
+    return SendPathCommand(CommandType_OpenAt, &params, sizeof(params), shmid);
+}
+
+int FS_CreateAt(int dirfd, const char* path, char type, int permissions)
+{
+    const int shmid = NewPathSHM(path);
+    struct CreateAtParameters params = { 
+        .dir_f_idx = dirfd,
+        .etype = type, 
+        .path_shmid = shmid, 
+        .permissions = permissions 
+    };
+    return SendPathCommand(CommandType_CreateAt, &params, sizeof(params), shmid);
+}
+
+int FS_RemoveAt(int dirfd, const char* path)
+{
+    const int shmid = NewPathSHM(path);
+    struct RemoveAtParameters params = { .dir_f_idx = dirfd, .path_shmid = shmid };
+    return SendPathCommand(CommandType_RemoveAt, &params, sizeof(params), shmid);
+}
+
+int FS_Stat(const char* path, struct StatRecord* st)
+{
+	struct CommandBuf cbuf = { .mtype = CommandType_Stat };
+
+    const int len = strlen(path) + 1;
+    const int shmid = GetNewSHM(len > sizeof(*st) ? len : sizeof(*st), 0666);
+    if(shmid == -1)
+    {
+        perror("[Stat 1] shmget");
+        exit(EXIT_FAILURE);
+    }
+
+    char* shm = shmat(shmid, NULL, 0);
+    strcpy(shm, path);
+
+    struct StatParameters params = { .shmid = shmid };
+    memcpy(cbuf.mtext, &params, sizeof(params));
+
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[Stat 2] msgsnd");
+        shmdt(shm);
+        shmctl(shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    const int retval = GetReturnValue(shmid);
+    if(retval == 0)
+        memcpy(st, shm, sizeof(*st));
+    shmdt(shm);
+    shmctl(shmid, IPC_RMID, NULL);
+    return retval;
+}
+
+int FS_Fstat(int fd, struct StatRecord* st)
+{
+	struct CommandBuf cbuf = { .mtype = CommandType_Fstat };
+
+    const int shmid = GetNewSHM(sizeof(*st), 0666);
+    if(shmid == -1)
+    {
+        perror("[Fstat 1] shmget");
+        exit(EXIT_FAILURE);
+    }
+
+    struct FstatParameters params = { .f_idx = fd, .shmid = shmid };
+    memcpy(cbuf.mtext, &params, sizeof(params));
+
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[Fstat 2] msgsnd");
+        shmctl(shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    const int retval = GetReturnValue(shmid);
+    if(retval == 0)
+    {
+        char* shm = shmat(shmid, NULL, 0);
+        memcpy(st, shm, sizeof(*st));
+        shmdt(shm);
+    }
+    shmctl(shmid, IPC_RMID, NULL);
+    return retval;
+}
+
+int FS_GetHandle(int fd, struct FileHandle* fh)
+{
+	struct CommandBuf cbuf = { .mtype = CommandType_GetHandle };
+
+    const int shmid = GetNewSHM(sizeof(*fh), 0666);
+    if(shmid == -1)
+    {
+        perror("[GetHandle 1] shmget");
+        exit(EXIT_FAILURE);
+    }
+
+    struct GetHandleParameters params = { .f_idx = fd, .shmid = shmid };
+    memcpy(cbuf.mtext, &params, sizeof(params));
+
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[GetHandle 2] msgsnd");
+        shmctl(shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    const int retval = GetReturnValue(shmid);
+    if(retval == 0)
+    {
+        char* shm = shmat(shmid, NULL, 0);
+        memcpy(fh, shm, sizeof(*fh));
+        shmdt(shm);
+    }
+    shmctl(shmid, IPC_RMID, NULL);
+    return retval;
+}
+
+int FS_OpenByHandle(const struct FileHandle* fh)
+{
+	struct CommandBuf cbuf = { .mtype = CommandType_OpenByHandle };
+    struct OpenByHandleParameters params = { .inode_block = fh->inode_block, .generation = fh->generation };
+    memcpy(cbuf.mtext, &params, sizeof(params));
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[OpenByHandle 1] msgsnd");
+        exit(EXIT_FAILURE);
+    }
+
+    struct ReturnBuf rbuf;
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
+    {
+        perror("[OpenByHandle 2] msgrcv");
+        exit(EXIT_FAILURE);
+    }
+    return rbuf.retval;
+}
+
+long long FS_Seek(int fd, long long offset, int whence)
+{
+	struct CommandBuf cbuf = { .mtype = CommandType_Seek };
+    struct SeekOffsetParameters params = { .f_idx = fd, .whence = whence, .offset = offset };
+    memcpy(cbuf.mtext, &params, sizeof(params));
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[Seek 1] msgsnd");
+        exit(EXIT_FAILURE);
+    }
+
+    struct ReturnBuf rbuf;
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
+    {
+        perror("[Seek 2] msgrcv");
+        exit(EXIT_FAILURE);
+    }
+    return rbuf.retval;
+}
+
+int FS_List(int fd, char* buf, int max_size)
+{
+	struct CommandBuf cbuf = { .mtype = CommandType_List };
     
-    const int shmid = GetNewSHM(size, 0666);
+    const int shmid = GetNewSHM(max_size, 0666);
     if(shmid == -1)
     {
         perror("[Read 1] shmget");
         exit(EXIT_FAILURE);
     }
 
-    struct ReadParameters params = { 
+    struct ListParameters params = { 
         .f_idx = fd,
-        .buf_shmid = shmid,
-        .size = size
+        .listing_shmid = shmid,
+        .size = max_size
     };
 
     memcpy(cbuf.mtext, &params, sizeof(params));
@@ -236,7 +626,7 @@ int FS_Read(int fd, char* buf, int size)
     }
 
     struct ReturnBuf rbuf;
-    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), 10, 0) == -1)
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
     {
         perror("[Read 3] msgrcv");
         shmctl(shmid, IPC_RMID, NULL);
@@ -254,58 +644,71 @@ int FS_Read(int fd, char* buf, int size)
     return rbuf.retval;
 }
 
-int FS_Write(int fd, char* buf, int size)
+int FS_ListPlus(int fd, char* buf, int max_size)
 {
-	struct CommandBuf cbuf = { .mtype = CommandType_Write };
+	struct CommandBuf cbuf = { .mtype = CommandType_ListPlus };
     
-    const int shmid = GetNewSHM(size, 0666);
+    const int shmid = GetNewSHM(max_size, 0666);
     if(shmid == -1)
     {
-        perror("[Read 1] shmget");
+        perror("[ListPlus 1] shmget");
         exit(EXIT_FAILURE);
     }
 
-    char* shm = shmat(shmid, NULL, 0);
-    memcpy(shm, buf, size);
-    shmdt(shm);
-
-    struct WriteParameters params = { 
+    struct ListParameters params = { 
         .f_idx = fd,
-        .buf_shmid = shmid,
-        .size = size
+        .listing_shmid = shmid,
+        .size = max_size
     };
 
     memcpy(cbuf.mtext, &params, sizeof(params));
 
     if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
     {
-        perror("[Read 2] msgsnd");
+        perror("[ListPlus 2] msgsnd");
         shmctl(shmid, IPC_RMID, NULL);
         exit(EXIT_FAILURE);
     }
 
     struct ReturnBuf rbuf;
-    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), 10, 0) == -1)
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
     {
-        perror("[Read 3] msgrcv");
+        perror("[ListPlus 3] msgrcv");
         shmctl(shmid, IPC_RMID, NULL);
         exit(EXIT_FAILURE);
     }
 
+    if(rbuf.retval > 0)
+    {
+        char* shm = shmat(shmid, NULL, 0);
+        memcpy(buf, shm, rbuf.retval);
+        shmdt(shm);
+    }
+
     shmctl(shmid, IPC_RMID, NULL);
     return rbuf.retval;
 }
 
-int FS_List(int fd, char* buf, int max_size)
+int FS_ListPage(int fd, long long* cookie, char* buf, int max_size)
 {
-	struct CommandBuf cbuf = { .mtype = CommandType_List };
+	struct CommandBuf cbuf = { .mtype = CommandType_ListPage };
     
-    const int shmid = GetNewSHM(max_size, 0666);
+    const int shmid = GetNewSHM(sizeof(struct ListPageHeader) + max_size, 0666);
     if(shmid == -1)
     {
-        perror("[Read 1] shmget");
+        perror("[ListPage 1] shmget");
+        exit(EXIT_FAILURE);
+    }
+
+    char* shm = shmat(shmid, NULL, 0);
+    if(shm == (char*)-1)
+    {
+        perror("[ListPage 2] shmat");
+        shmctl(shmid, IPC_RMID, NULL);
         exit(EXIT_FAILURE);
     }
+    struct ListPageHeader lh = { .cookie = *cookie };
+    memcpy(shm, &lh, sizeof(lh));
 
     struct ListParameters params = { 
         .f_idx = fd,
@@ -317,33 +720,144 @@ int FS_List(int fd, char* buf, int max_size)
 
     if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
     {
-        perror("[Read 2] msgsnd");
+        perror("[ListPage 3] msgsnd");
+        shmdt(shm);
         shmctl(shmid, IPC_RMID, NULL);
         exit(EXIT_FAILURE);
     }
 
     struct ReturnBuf rbuf;
-    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), 10, 0) == -1)
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
     {
-        perror("[Read 3] msgrcv");
+        perror("[ListPage 4] msgrcv");
+        shmdt(shm);
         shmctl(shmid, IPC_RMID, NULL);
         exit(EXIT_FAILURE);
     }
 
-    if(rbuf.retval > 0)
+    if(rbuf.retval >= 0)
     {
-        char* shm = shmat(shmid, NULL, 0);
-        memcpy(buf, shm, rbuf.retval);
-        shmdt(shm);
+        memcpy(&lh, shm, sizeof(lh));
+        *cookie = lh.cookie;
+        memcpy(buf, shm + sizeof(lh), rbuf.retval);
     }
 
+    shmdt(shm);
     shmctl(shmid, IPC_RMID, NULL);
     return rbuf.retval;
 }
 
+int FS_SeekData(int fd, int offset)
+{
+	struct CommandBuf cbuf = { .mtype = CommandType_SeekData };
+    struct SeekParameters params = { .f_idx = fd, .offset = offset };
+    memcpy(cbuf.mtext, &params, sizeof(params));
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[SeekData 1] msgsnd");
+        exit(EXIT_FAILURE);
+    }
+
+    struct ReturnBuf rbuf;
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
+    {
+        perror("[SeekData 2] msgrcv");
+        exit(EXIT_FAILURE);
+    }
+    return rbuf.retval;
+}
+
+int FS_SeekHole(int fd, int offset)
+{
+	struct CommandBuf cbuf = { .mtype = CommandType_SeekHole };
+    struct SeekParameters params = { .f_idx = fd, .offset = offset };
+    memcpy(cbuf.mtext, &params, sizeof(params));
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[SeekHole 1] msgsnd");
+        exit(EXIT_FAILURE);
+    }
+
+    struct ReturnBuf rbuf;
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
+    {
+        perror("[SeekHole 2] msgrcv");
+        exit(EXIT_FAILURE);
+    }
+    return rbuf.retval;
+}
+
+int FS_Truncate(int fd, int size)
+{
+	struct CommandBuf cbuf = { .mtype = CommandType_Truncate };
+    struct TruncateParameters params = { .f_idx = fd, .size = size };
+    memcpy(cbuf.mtext, &params, sizeof(params));
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[Truncate 1] msgsnd");
+        exit(EXIT_FAILURE);
+    }
+
+    struct ReturnBuf rbuf;
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
+    {
+        perror("[Truncate 2] msgrcv");
+        exit(EXIT_FAILURE);
+    }
+    return rbuf.retval;
+}
+
+int FS_Preallocate(int fd, int offset, int size)
+{
+	struct CommandBuf cbuf = { .mtype = CommandType_Preallocate };
+    struct PreallocateParameters params = { .f_idx = fd, .offset = offset, .size = size };
+    memcpy(cbuf.mtext, &params, sizeof(params));
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[Preallocate 1] msgsnd");
+        exit(EXIT_FAILURE);
+    }
+
+    struct ReturnBuf rbuf;
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
+    {
+        perror("[Preallocate 2] msgrcv");
+        exit(EXIT_FAILURE);
+    }
+    return rbuf.retval;
+}
+
 int FS_GetErrorMsg(char* buf, int max_size)
 {
+	struct CommandBuf cbuf = { .mtype = CommandType_ErrorInfo };
+
+    const int shmid = GetNewSHM(max_size, 0666);
+    if(shmid == -1)
+    {
+        perror("[ErrorInfo 1] shmget");
+        exit(EXIT_FAILURE);
+    }
+
+    struct ErrorInfoParameters params = { .buf_shmid = shmid, .buf_size = max_size };
+    memcpy(cbuf.mtext, &params, sizeof(params));
 
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[ErrorInfo 2] msgsnd");
+        shmctl(shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    const int retval = GetReturnValue(shmid);
+    if(retval >= 0)
+    {
+        char* shm = shmat(shmid, NULL, 0);
+        memcpy(buf, shm, retval + 1);
+        shmdt(shm);
+    }
+
+    shmctl(shmid, IPC_RMID, NULL);
+    return retval;
 }
 
 static int GetNewSHM(int size, int permissions)
@@ -358,7 +872,7 @@ static int GetNewSHM(int size, int permissions)
 static int GetReturnValue(int shmid)
 {
     struct ReturnBuf rbuf;
-    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), 10, 0) == -1)
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
     {
         perror("[Create 3] msgrcv");
         if(shmid != -1)
@@ -366,4 +880,131 @@ static int GetReturnValue(int shmid)
         exit(EXIT_FAILURE);
     }
     return rbuf.retval;
-}
\ No newline at end of file
+}
+static int CreateManyNameLength(const char* name)
+{
+    // a longer name doesn't fit in the record, it's sent empty so the server fails it
+    const int len = strlen(name);
+    return len > 255 ? 0 : len;
+}
+
+static int ReadAt(long mtype, int fd, char* buf, int size, long long offset)
+{
+	struct CommandBuf cbuf = { .mtype = mtype };
+    
+    const int shmid = GetNewSHM(size, 0666);
+    if(shmid == -1)
+    {
+        perror("[Read 1] shmget");
+        exit(EXIT_FAILURE);
+    }
+
+    struct ReadParameters params = { 
+        .f_idx = fd,
+        .buf_shmid = shmid,
+        .size = size,
+        .offset = offset
+    };
+
+    memcpy(cbuf.mtext, &params, sizeof(params));
+
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[Read 2] msgsnd");
+        shmctl(shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    struct ReturnBuf rbuf;
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
+    {
+        perror("[Read 3] msgrcv");
+        shmctl(shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    if(rbuf.retval > 0)
+    {
+        char* shm = shmat(shmid, NULL, 0);
+        memcpy(buf, shm, rbuf.retval);
+        shmdt(shm);
+    }
+
+    shmctl(shmid, IPC_RMID, NULL);
+    return rbuf.retval;
+}
+
+static int WriteAt(long mtype, int fd, const char* buf, int size, long long offset)
+{
+	struct CommandBuf cbuf = { .mtype = mtype };
+    
+    const int shmid = GetNewSHM(size, 0666);
+    if(shmid == -1)
+    {
+        perror("[Write 1] shmget");
+        exit(EXIT_FAILURE);
+    }
+
+    char* shm = shmat(shmid, NULL, 0);
+    memcpy(shm, buf, size);
+    shmdt(shm);
+
+    struct WriteParameters params = { 
+        .f_idx = fd,
+        .buf_shmid = shmid,
+        .size = size,
+        .offset = offset
+    };
+
+    memcpy(cbuf.mtext, &params, sizeof(params));
+
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[Write 2] msgsnd");
+        shmctl(shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    struct ReturnBuf rbuf;
+    if(msgrcv(qid, &rbuf, sizeof(rbuf.retval), return_mtype, 0) == -1)
+    {
+        perror("[Write 3] msgrcv");
+        shmctl(shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    shmctl(shmid, IPC_RMID, NULL);
+    return rbuf.retval;
+}
+
+static int NewPathSHM(const char* path)
+{
+    const int shmid = GetNewSHM(strlen(path) + 1, 0666);
+    if(shmid == -1)
+    {
+        perror("[Path 1] shmget");
+        exit(EXIT_FAILURE);
+    }
+
+    char* shm = shmat(shmid, NULL, 0);
+    strcpy(shm, path);
+    shmdt(shm);
+    return shmid;
+}
+
+static int SendPathCommand(long mtype, const void* params, int size, int shmid)
+{
+    struct CommandBuf cbuf = { .mtype = mtype };
+    memcpy(cbuf.mtext, params, size);
+
+    if(msgsnd(qid, &cbuf, sizeof(cbuf.mtext), 0) == -1)
+    {
+        perror("[Path 2] msgsnd");
+        shmctl(shmid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    const int retval = GetReturnValue(shmid);
+    shmctl(shmid, IPC_RMID, NULL);
+    return retval;
+}
@@ -0,0 +1,79 @@
+#include <Interface.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// threads open and close files as fast as they can, every thread its own file in its own directory
+// the elements stay opened by the main thread, so only the opened table is measured and not the disk
+// prints opens per second for 1, 2, 4 ... up to the given number of threads
+// usage: OpenBench [max threads] [seconds per run]
+
+using Clock = std::chrono::steady_clock;
+static const char* DiskFile = "OpenBench.disk";
+
+int main(int argc, char** argv)
+{
+    const int max_threads = argc > 1 ? std::atoi(argv[1]) : 8;
+    const double secs = argc > 2 ? std::atof(argv[2]) : 1;
+    if(max_threads <= 0 || secs <= 0)
+    {
+        std::cerr << "usage: " << argv[0] << " [max threads] [seconds per run]" << std::endl;
+        return 1;
+    }
+
+    unlink(DiskFile);
+    {
+        FS::Interface inf(DiskFile);
+        std::vector<std::string> paths;
+        std::vector<int> held;
+        for(int i = 0; i < max_threads; i++)
+        {
+            const std::string dir = "/d" + std::to_string(i);
+            paths.push_back(dir + "/f");
+            if(!inf.Add(dir, FS::ElementType::Directory, 0, 6) || !inf.Add(paths.back(), FS::ElementType::File, 0, 6))
+            {
+                std::cerr << inf.GetLastError() << std::endl;
+                return 1;
+            }
+            held.push_back(inf.Open(paths.back()));
+        }
+
+        for(int num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+        {
+            std::atomic<bool> done{ false };
+            std::atomic<long long> opens{ 0 };
+            std::vector<std::thread> threads;
+            for(int t = 0; t < num_threads; t++)
+            {
+                threads.emplace_back([&, t]() {
+                    long long n = 0;
+                    while(!done.load(std::memory_order_relaxed))
+                    {
+                        const int idx = inf.Open(paths[t]);
+                        if(idx == -1)
+                            break;
+                        inf.Close(idx);
+                        n++;
+                    }
+                    opens += n;
+                });
+            }
+            const auto start = Clock::now();
+            std::this_thread::sleep_for(std::chrono::duration<double>(secs));
+            done = true;
+            for(auto& t : threads)
+                t.join();
+            const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            std::cout << num_threads << " threads: " << (long long)(opens / elapsed) << " opens/s" << std::endl;
+        }
+
+        for(int idx : held)
+            inf.Close(idx);
+    }
+    unlink(DiskFile);
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <RWLock.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// readers hammer one lock while a single writer takes it over and over
+// prints how long the writer waited for the lock and how many shared locks the readers got through
+// usage: RWLockBench [reader threads] [writer acquisitions]
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv)
+{
+    const int num_readers = argc > 1 ? std::atoi(argv[1]) : 8;
+    const int num_writes = argc > 2 ? std::atoi(argv[2]) : 10000;
+    if(num_readers < 0 || num_writes <= 0)
+    {
+        std::cerr << "usage: " << argv[0] << " [reader threads] [writer acquisitions]" << std::endl;
+        return 1;
+    }
+
+    RWLock lock;
+    std::atomic<bool> done{ false };
+    std::atomic<long long> reads{ 0 };
+    std::vector<std::thread> readers;
+    for(int i = 0; i < num_readers; i++)
+    {
+        readers.emplace_back([&]() {
+            long long n = 0;
+            while(!done.load(std::memory_order_relaxed))
+            {
+                lock.lock_shared();
+                lock.unlock_shared();
+                n++;
+            }
+            reads += n;
+        });
+    }
+
+    // let the readers get going before measuring the writer
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::vector<double> waits;
+    waits.reserve(num_writes);
+    const auto start = Clock::now();
+    for(int i = 0; i < num_writes; i++)
+    {
+        const auto t0 = Clock::now();
+        lock.lock();
+        const auto t1 = Clock::now();
+        lock.unlock();
+        waits.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    const double secs = std::chrono::duration<double>(Clock::now() - start).count();
+    done = true;
+    for(auto& t : readers)
+        t.join();
+
+    std::sort(waits.begin(), waits.end());
+    auto percentile = [&](double p) {
+        return waits[std::min(waits.size() - 1, (size_t)(p * waits.size()))];
+    };
+    std::cout << num_readers << " readers, " << num_writes << " writer acquisitions" << std::endl;
+    std::cout << "writer wait p50 " << percentile(0.5) << "us p99 " << percentile(0.99)
+        << "us max " << waits.back() << "us" << std::endl;
+    std::cout << (long long)(reads / secs) << " shared locks/s" << std::endl;
+    return 0;
+}
@@ -1,131 +1,338 @@
-#include <BlockManager.h>
-#include <cassert>
-
-BlockManager::BlockManager(Disk& d, const std::string& filename)
-	:
-	d(d)
-{
-    // if the file doesnt exist create it and then initialize it
-	if (!d.Mount(filename))
-	{
-		Disk::Create(filename);
-		d.Mount(filename);
-		UpdateSuperblock();
-		return;
-	}
-    // read the superblock otherwise
-	d.Read(SuperBlockNum, &sb);
-}
-
-BlockManager::~BlockManager()
-{
-    // unmount the disk
-	d.Unmount();
-}
-
-unsigned int BlockManager::GetFreeBlock() const
-{
-    // check each block to see if it is free
-	for (int i = 0; i < NumBlocks; i++)
-	{
-        // return the idx of the first free block found
-		if (BlockIsFree(i))
-			return i;
-	}
-    // return zero if none are found
-	return 0;
-}
-
-void BlockManager::AllocateBlock(unsigned int block_num)
-{
-    // update the bit representing the block in the superblock
-    // and write the block to the disk
-	const int char_num = block_num / 8;
-	const int bit_num = block_num % 8;
-	sb.bitmap[char_num] |= (1 << bit_num);
-	UpdateSuperblock();
-}
-
-unsigned int BlockManager::AlloateFreeBlock()
-{
-    // iterate over every block to find a free block, allocate it, and return its index
-	for (int i = 0; i < NumBlocks; i++)
-	{
-		if (BlockIsFree(i))
-		{
-			AllocateBlock(i);
-			return i;
-		}
-	}
-    // return 0 if no new block is found
-	return 0;
-}
-
-unsigned int BlockManager::FirstAllocatableBlock() const
-{
-    // the first block after the superblock is allocatable
-	return SuperBlockNum + 1;;
-}
-
-void BlockManager::FreeBlock(int block_num)
-{
-    // set the bit representing block_num in the superblock to 0 and save it to disk
-	const int char_num = block_num / 8;
-	const int bit_num = block_num % 8;
-	sb.bitmap[char_num] &= ~(1 << bit_num);
-	UpdateSuperblock();
-}
-
-bool BlockManager::BlockIsFree(unsigned int block_num) const
-{
-    // check if the bit representing nlock num is set to 1
-	const int char_num = block_num / 8;
-	const int bit_num = block_num % 8;
-	return !(sb.bitmap[char_num] & (1 << bit_num));
-}
-
-void BlockManager::Read(unsigned int block_num, void* buf) const
-{
-    // ensure write operations are only performed on allocatable blocks
-	assert(block_num >= FirstAllocatableBlock());
-	if (block_num >= NumBlocks)
-		return;
-    // read the given block
-	d.Read(block_num, buf);
-}
-
-void BlockManager::Write(unsigned int block_num, const void* buf)
-{
-    // ensure read operations are only performed on allocatable blocks
-	assert(block_num >= FirstAllocatableBlock());
-	if (block_num >= NumBlocks)
-		return;
-    // write the given block
-	d.Write(block_num, buf);
-}
-
-unsigned int BlockManager::GetNumFreeBlocks() const
-{
-    // iterate over every block to count the number of free blocks
-	unsigned int count = 0;
-	for (unsigned int i = 0; i < NumBlocks; i++)
-	{
-		if (BlockIsFree(i))
-		{
-			count++;
-		}
-	}
-	return count;
-}
-
-unsigned int BlockManager::GetFreeSpace() const
-{
-    // free space = numbr of free blocks * block size
-	return GetNumFreeBlocks() * Disk::BlockSize;
-}
-
-void BlockManager::UpdateSuperblock()
-{
-    // write the superblock to disk
-	d.Write(SuperBlockNum, &sb);
-}
+#include <BlockManager.h>
+#include <cassert>
+#include <algorithm>
+#include <set>
+#include <ctime>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+BlockManager::BlockManager(Disk& d, const std::string& filename, const MountOptions& opts)
+	:
+	d(d),
+	opts(opts),
+	next_generation((unsigned int)time(NULL))
+{
+    // if the file doesnt exist create it and then initialize it
+	if (!d.Mount(filename))
+	{
+		Disk::Create(filename);
+		d.Mount(filename);
+		char buf[Disk::BlockSize] = {};
+		FormatHeader hdr = {};
+		memcpy(hdr.magic, FormatMagic, sizeof(hdr.magic));
+		hdr.version = FormatVersion;
+		memcpy(buf, &hdr, sizeof(hdr));
+		d.Write(FormatBlockNum, buf);
+        // the format header and the reference count table are reserved, the table starts out zeroed by Disk::Create
+		MarkAllocated(FormatBlockNum);
+		for (unsigned int i = 0; i < NumRefCountBlocks; i++)
+			MarkAllocated(RefCountBlockNum + i);
+		UpdateSuperblock();
+		return;
+	}
+    // a disk laid out differently would be misread (and written over) from the first block on
+	char buf[Disk::BlockSize];
+	d.Read(FormatBlockNum, buf);
+	FormatHeader hdr;
+	memcpy(&hdr, buf, sizeof(hdr));
+	if (memcmp(hdr.magic, FormatMagic, sizeof(hdr.magic)) != 0 || hdr.version != FormatVersion)
+	{
+		d.Unmount();
+		std::ostringstream oss;
+		oss << filename << ": unsupported disk format";
+		if (memcmp(hdr.magic, FormatMagic, sizeof(hdr.magic)) == 0)
+			oss << " version " << hdr.version << " (expected " << FormatVersion << ")";
+		oss << ", remove it to format a new disk";
+		throw std::runtime_error(oss.str());
+	}
+    // read the superblock and reference counts otherwise
+	d.Read(SuperBlockNum, &sb);
+	for (unsigned int i = 0; i < NumRefCountBlocks; i++)
+		d.Read(RefCountBlockNum + i, ref_counts + i * Disk::BlockSize);
+}
+
+BlockManager::~BlockManager()
+{
+    // unmount the disk
+	d.Unmount();
+}
+
+unsigned int BlockManager::GetFreeBlock() const
+{
+	std::lock_guard<std::recursive_mutex> lock(mtx);
+    // check each block to see if it is free
+	for (unsigned int i = 0; i < NumBlocks; i++)
+	{
+        // return the idx of the first free block found
+		if (BlockIsFree(i))
+			return i;
+	}
+    // return zero if none are found
+	return 0;
+}
+
+void BlockManager::AllocateBlock(unsigned int block_num)
+{
+	std::lock_guard<std::recursive_mutex> lock(mtx);
+    // update the bit representing the block in the superblock
+    // and write the block to the disk
+	MarkAllocated(block_num);
+	UpdateSuperblock();
+}
+
+unsigned int BlockManager::AlloateFreeBlock()
+{
+	std::lock_guard<std::recursive_mutex> lock(mtx);
+    // the remaining free blocks may all be reserved
+	if (GetNumFreeBlocks() == 0)
+		return 0;
+    // iterate over every block to find a free block, allocate it, and return its index
+	for (unsigned int i = 0; i < NumBlocks; i++)
+	{
+		if (BlockIsFree(i))
+		{
+			AllocateBlock(i);
+			return i;
+		}
+	}
+    // return 0 if no new block is found
+	return 0;
+}
+
+bool BlockManager::AllocateBlocks(unsigned int count, std::vector<unsigned int>& block_nums, bool from_reserved)
+{
+	std::lock_guard<std::recursive_mutex> lock(mtx);
+	if (count == 0)
+		return true;
+	if (GetNumFreeBlocks() + (from_reserved ? count : 0) < count)
+		return false;
+	if (from_reserved)
+		num_reserved -= count;
+
+    // look for the first run of count free blocks
+	unsigned int run_start = 0;
+	unsigned int run_len = 0;
+	for (unsigned int i = FirstAllocatableBlock(); i < NumBlocks && run_len < count; i++)
+	{
+		if (!BlockIsFree(i))
+			run_len = 0;
+		else if (run_len++ == 0)
+			run_start = i;
+	}
+
+	if (run_len == count)
+	{
+		for (unsigned int i = run_start; i < run_start + count; i++)
+		{
+			MarkAllocated(i);
+			block_nums.push_back(i);
+		}
+	}
+	else // too fragmented for a single run, fall back to the first free blocks
+	{
+		for (unsigned int i = FirstAllocatableBlock(); i < NumBlocks && count > 0; i++)
+		{
+			if (BlockIsFree(i))
+			{
+				MarkAllocated(i);
+				block_nums.push_back(i);
+				count--;
+			}
+		}
+	}
+	UpdateSuperblock();
+	return true;
+}
+
+bool BlockManager::ReserveBlocks(unsigned int count)
+{
+	std::lock_guard<std::recursive_mutex> lock(mtx);
+	if (GetNumFreeBlocks() < count)
+		return false;
+	num_reserved += count;
+	return true;
+}
+
+void BlockManager::UnreserveBlocks(unsigned int count)
+{
+	std::lock_guard<std::recursive_mutex> lock(mtx);
+	num_reserved -= count;
+}
+
+unsigned int BlockManager::FirstAllocatableBlock() const
+{
+    // the first block after the format header and the reference count table is allocatable
+	return RefCountBlockNum + NumRefCountBlocks;
+}
+
+void BlockManager::FreeBlock(int block_num)
+{
+	std::lock_guard<std::recursive_mutex> lock(mtx);
+    // a shared block just loses an owner
+	if (ref_counts[block_num] > 0)
+	{
+		ref_counts[block_num]--;
+		UpdateRefCounts(block_num);
+		return;
+	}
+    // set the bit representing block_num in the superblock to 0 and save it to disk
+	MarkFree(block_num);
+	UpdateSuperblock();
+}
+
+void BlockManager::FreeBlocks(const std::vector<unsigned int>& block_nums)
+{
+	std::lock_guard<std::recursive_mutex> lock(mtx);
+	bool bitmap_changed = false;
+	std::set<unsigned int> ref_blocks_changed;
+	for (unsigned int block_num : block_nums)
+	{
+		if (ref_counts[block_num] > 0)
+		{
+			ref_counts[block_num]--;
+			ref_blocks_changed.insert(block_num / Disk::BlockSize);
+		}
+		else
+		{
+			MarkFree(block_num);
+			bitmap_changed = true;
+		}
+	}
+    // every changed block of metadata is only written once
+	if (bitmap_changed)
+		UpdateSuperblock();
+	for (unsigned int i : ref_blocks_changed)
+		UpdateRefCounts(i * Disk::BlockSize);
+}
+
+bool BlockManager::ShareBlocks(const std::vector<unsigned int>& block_nums)
+{
+	std::lock_guard<std::recursive_mutex> lock(mtx);
+    // check every block first so nothing is shared if any of them can't be
+    // (a block may be in the list more than once)
+	unsigned char counts[NumBlocks];
+	std::copy(std::begin(ref_counts), std::end(ref_counts), counts);
+	for (unsigned int block_num : block_nums)
+	{
+		assert(!BlockIsFree(block_num));
+		if (counts[block_num]++ == MaxExtraRefs)
+			return false;
+	}
+
+	std::set<unsigned int> ref_blocks_changed;
+	for (unsigned int block_num : block_nums)
+	{
+		ref_counts[block_num]++;
+		ref_blocks_changed.insert(block_num / Disk::BlockSize);
+	}
+	for (unsigned int i : ref_blocks_changed)
+		UpdateRefCounts(i * Disk::BlockSize);
+	return true;
+}
+
+bool BlockManager::BlockIsShared(unsigned int block_num) const
+{
+	std::lock_guard<std::recursive_mutex> lock(mtx);
+	return ref_counts[block_num] > 0;
+}
+
+bool BlockManager::BlockIsFree(unsigned int block_num) const
+{
+    // blocks past the end of the disk hold nothing
+	if (block_num >= NumBlocks)
+		return true;
+	std::lock_guard<std::recursive_mutex> lock(mtx);
+    // check if the bit representing nlock num is set to 1
+	const int char_num = block_num / 8;
+	const int bit_num = block_num % 8;
+	return !(sb.bitmap[char_num] & (1 << bit_num));
+}
+
+void BlockManager::Read(unsigned int block_num, void* buf) const
+{
+    // ensure write operations are only performed on allocatable blocks
+	assert(block_num >= FirstAllocatableBlock());
+	if (block_num >= NumBlocks)
+		return;
+    // read the given block
+	d.Read(block_num, buf);
+}
+
+void BlockManager::ReadBlocks(unsigned int first_block, unsigned int count, void* buf) const
+{
+	assert(first_block >= FirstAllocatableBlock());
+	if (first_block + count > NumBlocks)
+		return;
+	d.Read(first_block, count, buf);
+}
+
+void BlockManager::Write(unsigned int block_num, const void* buf)
+{
+    // ensure read operations are only performed on allocatable blocks
+	assert(block_num >= FirstAllocatableBlock());
+	if (block_num >= NumBlocks)
+		return;
+    // write the given block
+	d.Write(block_num, buf);
+}
+
+unsigned int BlockManager::GetNumFreeBlocks() const
+{
+	std::lock_guard<std::recursive_mutex> lock(mtx);
+    // iterate over every block to count the number of free blocks
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < NumBlocks; i++)
+	{
+		if (BlockIsFree(i))
+		{
+			count++;
+		}
+	}
+	return count - num_reserved;
+}
+
+unsigned int BlockManager::GetFreeSpace() const
+{
+    // free space = numbr of free blocks * block size
+	return GetNumFreeBlocks() * Disk::BlockSize;
+}
+
+const MountOptions& BlockManager::GetMountOptions() const
+{
+	return opts;
+}
+
+unsigned int BlockManager::NextGeneration()
+{
+	unsigned int generation;
+	while ((generation = next_generation++) == 0);
+	return generation;
+}
+
+void BlockManager::MarkAllocated(unsigned int block_num)
+{
+	const int char_num = block_num / 8;
+	const int bit_num = block_num % 8;
+	sb.bitmap[char_num] |= (1 << bit_num);
+}
+
+void BlockManager::MarkFree(unsigned int block_num)
+{
+	const int char_num = block_num / 8;
+	const int bit_num = block_num % 8;
+	sb.bitmap[char_num] &= ~(1 << bit_num);
+}
+
+void BlockManager::UpdateSuperblock()
+{
+    // write the superblock to disk
+	d.Write(SuperBlockNum, &sb);
+}
+
+void BlockManager::UpdateRefCounts(unsigned int block_num)
+{
+    // only the table block holding this count needs to be written
+	const unsigned int table_idx = block_num / Disk::BlockSize;
+	d.Write(RefCountBlockNum + table_idx, ref_counts + table_idx * Disk::BlockSize);
+}
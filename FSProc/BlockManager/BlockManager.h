@@ -1,55 +1,147 @@
-#pragma once
-#include <Disk.h>
-
-class BlockManager
-{
-	struct SuperBlock
-	{
-		char bitmap[Disk::BlockSize];
-	};
-
-	static constexpr unsigned int SuperBlockNum = 0;
-	static constexpr unsigned int NumBlocks = sizeof(SuperBlock) * 8;
-
-public:
-    // paremeterized ctor only, needs a disk object and a file to load as the disk
-	BlockManager(Disk& d, const std::string& filename);
-    // unmounts the loaded file
-	~BlockManager();
-    // no copy ctors or = operators
-	BlockManager(const BlockManager&) = delete;
-	BlockManager& operator=(const BlockManager&) = delete;
-
-    // get the index to a block the has not been marked as allocated
-    // returns 0 if no block is free
-	unsigned int GetFreeBlock() const;
-    // mark a given block as allocated
-	void AllocateBlock(unsigned int block_num);
-    // mark the first free block as allocated and get its index
-    // returns zero if no block is free
-	unsigned int AlloateFreeBlock();
-    // get the index to the first block that is allowed to be allocated by this block manager
-    // this is the first block after the superblock
-	unsigned int FirstAllocatableBlock() const;
-    // free the block at the given index
-	void FreeBlock(int block_num);
-    // check if the block at the given idx is free
-	bool BlockIsFree(unsigned int block_num) const;
-    // read data from the given blockl (can only read a full block)
-	void Read(unsigned int block_num, void* buf) const;
-    // write data to a given block (can only write a full block)
-	void Write(unsigned int block_num, const void* buf);
-    // get the number of free blocks left in the file/disk
-	unsigned int GetNumFreeBlocks() const;
-    // get thwe total free space left in the file (free blocks * block size)
-	unsigned int GetFreeSpace() const;
-
-private:
-    // writes superblock to the file
-	void UpdateSuperblock();
-
-private:
-	Disk& d;
-	SuperBlock sb = { { 0x1 } };
-};
-
+#pragma once
+#include <Disk.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// how access times are kept up to date on the mounted disk
+enum class AtimeMode
+{
+	Strict,   // update on every read
+	Relatime, // update only if older than the modification time or a day old
+	Noatime,  // never update
+};
+
+// how a directory indexes its entries by name
+enum class DirFormat
+{
+	Hash,  // fastest lookups, entries are listed unordered
+	BTree, // entries are kept sorted by name and can be listed from any name onwards
+};
+
+// options the disk is mounted with
+struct MountOptions
+{
+	AtimeMode atime = AtimeMode::Relatime;
+    // keep timestamp-only changes in memory until the inode is saved for another reason
+    // or until the next periodic sync
+	bool lazytime = false;
+    // seconds between periodic syncs of lazy timestamps and delayed writes
+	unsigned int sync_interval = 30;
+    // keep written data for unallocated blocks in memory and only choose blocks for it when it is flushed
+	bool delalloc = false;
+    // format of newly created directories, existing ones keep theirs
+	DirFormat dir_format = DirFormat::Hash;
+};
+
+class BlockManager
+{
+	struct SuperBlock
+	{
+		char bitmap[Disk::BlockSize];
+	};
+    // kept in the block after the superblock (which is all bitmap), tells what layout the disk was created with
+	struct FormatHeader
+	{
+		char magic[8];
+		unsigned int version;
+	};
+
+	static constexpr unsigned int SuperBlockNum = 0;
+	static constexpr unsigned int NumBlocks = sizeof(SuperBlock) * 8;
+	static constexpr unsigned int FormatBlockNum = SuperBlockNum + 1;
+	static constexpr char FormatMagic[8] = "OSPFS";
+    // bumped whenever the layout changes, disks with any other version are not mounted
+    // 1: reference count table, root after it, inode generations
+	static constexpr unsigned int FormatVersion = 1;
+    // blocks shared between files (clones) keep a count of their extra owners
+    // the counts are kept one byte per block in the blocks right after the format header
+	static constexpr unsigned int RefCountBlockNum = FormatBlockNum + 1;
+	static constexpr unsigned int NumRefCountBlocks = NumBlocks / Disk::BlockSize;
+	static constexpr unsigned int MaxExtraRefs = 255;
+
+public:
+    // paremeterized ctor only, needs a disk object and a file to load as the disk
+    // throws if the file holds a disk of another format (older disks have no format header), 
+    // it has to be removed to be formatted again
+	BlockManager(Disk& d, const std::string& filename, const MountOptions& opts = {});
+    // unmounts the loaded file
+	~BlockManager();
+    // no copy ctors or = operators
+	BlockManager(const BlockManager&) = delete;
+	BlockManager& operator=(const BlockManager&) = delete;
+
+    // get the index to a block the has not been marked as allocated
+    // returns 0 if no block is free
+	unsigned int GetFreeBlock() const;
+    // mark a given block as allocated
+	void AllocateBlock(unsigned int block_num);
+    // mark the first free block as allocated and get its index
+    // returns zero if no block is free
+	unsigned int AlloateFreeBlock();
+    // mark count free blocks as allocated and append their indices to block_nums
+    // a contiguous run is used if one exists, the superblock is only written once
+    // allocates nothing and returns false if there aren't enough free blocks
+    // if from_reserved is set the blocks are taken out of an earlier ReserveBlocks
+	bool AllocateBlocks(unsigned int count, std::vector<unsigned int>& block_nums, bool from_reserved = false);
+    // set aside count free blocks for a later AllocateBlocks without choosing which ones yet
+    // returns false if there aren't enough free blocks
+	bool ReserveBlocks(unsigned int count);
+    // give back blocks reserved with ReserveBlocks that are no longer needed
+	void UnreserveBlocks(unsigned int count);
+    // get the index to the first block that is allowed to be allocated by this block manager
+    // this is the first block after the superblock, the format header and the reference count table
+	unsigned int FirstAllocatableBlock() const;
+    // free the block at the given index
+    // a shared block only loses one owner and stays allocated
+	void FreeBlock(int block_num);
+    // free all the given blocks, the superblock is only written once
+	void FreeBlocks(const std::vector<unsigned int>& block_nums);
+    // add an owner to each of the given allocated blocks
+    // returns false (and shares nothing) if any of them already has the maximum number of owners
+	bool ShareBlocks(const std::vector<unsigned int>& block_nums);
+    // check if the block at the given idx has more than one owner
+    // shared blocks must be copied before they are written to
+	bool BlockIsShared(unsigned int block_num) const;
+    // check if the block at the given idx is free
+	bool BlockIsFree(unsigned int block_num) const;
+    // read data from the given blockl (can only read a full block)
+	void Read(unsigned int block_num, void* buf) const;
+    // read count consecutive blocks starting at first_block with a single disk access
+	void ReadBlocks(unsigned int first_block, unsigned int count, void* buf) const;
+    // write data to a given block (can only write a full block)
+	void Write(unsigned int block_num, const void* buf);
+    // get the number of free blocks left in the file/disk
+    // reserved blocks are not counted as free
+	unsigned int GetNumFreeBlocks() const;
+    // get thwe total free space left in the file (free blocks * block size)
+	unsigned int GetFreeSpace() const;
+    // get the options the disk was mounted with
+	const MountOptions& GetMountOptions() const;
+    // get a generation number for a newly created inode, never 0
+    // counting starts at the mount time, so numbers handed out before a remount don't come up again in practice
+	unsigned int NextGeneration();
+
+private:
+    // set/clear the bit of a block in the in-memory superblock
+	void MarkAllocated(unsigned int block_num);
+	void MarkFree(unsigned int block_num);
+    // writes superblock to the file
+	void UpdateSuperblock();
+    // writes the reference count table block that holds the count of the given block
+	void UpdateRefCounts(unsigned int block_num);
+
+private:
+	Disk& d;
+	const MountOptions opts;
+	SuperBlock sb = { { 0x1 } };
+    // number of owners each block has on top of the first
+	unsigned char ref_counts[NumBlocks] = {};
+    // free blocks promised to delayed writes
+	unsigned int num_reserved = 0;
+    // guards the bitmap, reference counts and reservations, blocks are freed from several threads
+    // recursive as the public functions call each other
+	mutable std::recursive_mutex mtx;
+	std::atomic<unsigned int> next_generation;
+};
+
@@ -0,0 +1,90 @@
+#include "DentryCache.h"
+using namespace FS;
+
+#include <algorithm>
+
+DentryCache::DentryCache(size_t max_entries)
+    :
+    max_per_shard(std::max<size_t>(max_entries / NumShards, 1))
+{}
+
+bool DentryCache::Lookup(unsigned int parent, const std::string& name, Dentry& d, unsigned long& generation)
+{
+    const Key k = { parent, name };
+    Shard& s = GetShard(k);
+    std::lock_guard<std::mutex> lock(s.mtx);
+    auto it = s.map.find(k);
+    if(it == s.map.end())
+    {
+        generation = s.generation;
+        return false;
+    }
+    // move it to the front of the LRU list
+    s.lru.splice(s.lru.begin(), s.lru, it->second);
+    d = it->second->second;
+    return true;
+}
+
+void DentryCache::Insert(unsigned int parent, const std::string& name, const Dentry& d, unsigned long generation)
+{
+    Key k = { parent, name };
+    Shard& s = GetShard(k);
+    std::lock_guard<std::mutex> lock(s.mtx);
+    // the directory was read before an invalidation, what was read may already be stale
+    if(s.generation != generation)
+        return;
+    auto it = s.map.find(k);
+    if(it != s.map.end())
+    {
+        it->second->second = d;
+        s.lru.splice(s.lru.begin(), s.lru, it->second);
+        return;
+    }
+    if(s.map.size() >= max_per_shard)
+    {
+        s.map.erase(s.lru.back().first);
+        s.lru.pop_back();
+    }
+    s.lru.emplace_front(std::move(k), d);
+    s.map.emplace(s.lru.front().first, s.lru.begin());
+}
+
+void DentryCache::Invalidate(unsigned int parent, const std::string& name)
+{
+    const Key k = { parent, name };
+    Shard& s = GetShard(k);
+    std::lock_guard<std::mutex> lock(s.mtx);
+    s.generation++;
+    auto it = s.map.find(k);
+    if(it == s.map.end())
+        return;
+    s.lru.erase(it->second);
+    s.map.erase(it);
+}
+
+void DentryCache::InvalidateDir(unsigned int parent)
+{
+    // names are spread over every shard, so all of them have to be checked
+    for(Shard& s : shards)
+    {
+        std::lock_guard<std::mutex> lock(s.mtx);
+        s.generation++;
+        for(auto it = s.lru.begin(); it != s.lru.end(); )
+        {
+            if(it->first.parent == parent)
+            {
+                s.map.erase(it->first);
+                it = s.lru.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+}
+
+DentryCache::Shard& DentryCache::GetShard(const Key& k)
+{
+    return shards[KeyHash()(k) % NumShards];
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <FS.h>
+#include <array>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace FS
+{
+    // caches what a name in a directory resolves to, so path lookups don't have to read directories
+    // names that don't exist are cached too (negative entries), an Add or Remove must invalidate its name
+    // the cache is split into shards with their own lock and LRU list to keep contention down
+    class DentryCache
+    {
+    public:
+        struct Dentry
+        {
+            // inode block of the element, 0 if the name doesn't exist
+            unsigned int block_num;
+            ElementType type;
+            // the directory's unlink stamp when the entry was read, see Directory::Lookup
+            unsigned long unlink_stamp = 0;
+        };
+    private:
+        struct Key
+        {
+            unsigned int parent;
+            std::string name;
+
+            bool operator==(const Key& rhs) const
+            {
+                return parent == rhs.parent && name == rhs.name;
+            }
+        };
+        struct KeyHash
+        {
+            size_t operator()(const Key& k) const
+            {
+                return std::hash<std::string>()(k.name) ^ (k.parent * 0x9e3779b9u);
+            }
+        };
+        // least recently used at the back
+        using LRUList = std::list<std::pair<Key, Dentry>>;
+        struct Shard
+        {
+            std::mutex mtx;
+            LRUList lru;
+            std::unordered_map<Key, LRUList::iterator, KeyHash> map;
+            // bumped by every invalidation
+            unsigned long generation = 0;
+        };
+        static constexpr size_t NumShards = 16;
+    public:
+        // max_entries is split evenly between the shards
+        explicit DentryCache(size_t max_entries);
+        DentryCache(const DentryCache&) = delete;
+        DentryCache& operator=(const DentryCache&) = delete;
+
+        // look up a name in the directory whose inode is at parent
+        // returns false on a miss, a hit with d.block_num 0 means the name doesn't exist
+        // on a miss, generation is set to what has to be passed to Insert after reading the directory
+        bool Lookup(unsigned int parent, const std::string& name, Dentry& d, unsigned long& generation);
+        // cache what a name resolves to, evicting the least recently used entry of its shard if full
+        // nothing is cached if the name may have been invalidated since the Lookup that returned generation
+        void Insert(unsigned int parent, const std::string& name, const Dentry& d, unsigned long generation);
+        // drop the entry for a name that was added or removed
+        void Invalidate(unsigned int parent, const std::string& name);
+        // drop every entry in a directory that was removed (its inode block may be reused)
+        void InvalidateDir(unsigned int parent);
+
+    private:
+        Shard& GetShard(const Key& k);
+
+    private:
+        const size_t max_per_shard;
+        std::array<Shard, NumShards> shards;
+    };
+}
@@ -0,0 +1,266 @@
+#include "BTreeIndex.h"
+using namespace FS;
+
+#include <algorithm>
+#include <string.h>
+
+BTreeIndex BTreeIndex::Create(BlockManager& bm)
+{
+    BTreeIndex index;
+    index.inode_block = bm.AlloateFreeBlock();
+    if(index.inode_block == 0)
+        return index;
+    index.inode = Inode::Create(bm, index.inode_block, ElementType::Index, 0, 0);
+    if(!index.Init(bm))
+        index.Free(bm);
+    return index;
+}
+
+BTreeIndex BTreeIndex::Load(const BlockManager& bm, unsigned int inode_block)
+{
+    BTreeIndex index;
+    index.inode_block = inode_block;
+    index.inode = Inode::Load(bm, inode_block);
+    index.inode.Read(bm, 0, &index.hdr, sizeof(Header));
+    return index;
+}
+
+unsigned int BTreeIndex::Find(const BlockManager& bm, const std::string& name, 
+    const std::function<bool(unsigned int)>&) const
+{
+    // the tree stores the names, so there is nothing left for a matches callback to check
+    Node leaf;
+    FindLeaf(bm, name, leaf);
+    auto it = std::lower_bound(leaf.records.begin(), leaf.records.end(), name, 
+        [](const auto& rec, const std::string& key) { return rec.first < key; });
+    if(it != leaf.records.end() && it->first == name)
+        return it->second;
+    return 0;
+}
+
+bool BTreeIndex::Insert(BlockManager& bm, const std::string& name, unsigned int ref)
+{
+    // every node on the way down may split, and the root may need a new parent
+    const unsigned int end = (hdr.num_nodes + hdr.height + 1) * NodeSize;
+    if(end > Inode::MaxSize)
+        return false;
+    // the blocks of every node the insert may write are allocated before the tree is touched,
+    // so none of the writes can come up short and leave a split half done
+    // whatever isn't used is kept for the nodes later inserts append
+    if(inode.GetSize() < end && !inode.Preallocate(bm, inode_block, 0, end, false))
+        return false;
+
+    Split split;
+    if(InsertInto(bm, hdr.root, name, ref, split))
+    {
+        // the root was split, the tree grows a level
+        Node root;
+        root.is_leaf = false;
+        root.link = hdr.root;
+        root.records.push_back({ split.key, split.node });
+        hdr.root = AppendNode(bm, root);
+        hdr.height++;
+    }
+    SaveHeader(bm);
+    return true;
+}
+
+void BTreeIndex::Erase(BlockManager& bm, const std::string& name, unsigned int ref)
+{
+    Node leaf;
+    const unsigned int leaf_id = FindLeaf(bm, name, leaf);
+    auto it = std::find_if(leaf.records.begin(), leaf.records.end(), 
+        [&](const auto& rec) { return rec.first == name && rec.second == ref; });
+    if(it == leaf.records.end())
+        return;
+    // keys in the parents may still refer to the name, they stay valid as separators
+    leaf.records.erase(it);
+    WriteNode(bm, leaf_id, leaf);
+}
+
+void BTreeIndex::Clear(BlockManager& bm)
+{
+    inode.Truncate(bm, inode_block, 0);
+    Init(bm);
+}
+
+void BTreeIndex::Free(BlockManager& bm)
+{
+    if(inode_block == 0)
+        return;
+    inode.FreeAll(bm, inode_block);
+    bm.FreeBlock(inode_block);
+    inode_block = 0;
+    hdr = {};
+}
+
+void BTreeIndex::CollectBlocks(const BlockManager& bm, std::vector<unsigned int>& block_nums) const
+{
+    if(inode_block == 0)
+        return;
+    inode.CollectBlocks(bm, block_nums);
+    block_nums.push_back(inode_block);
+}
+
+bool BTreeIndex::Scan(const BlockManager& bm, const std::string& from, 
+    const std::function<bool(const std::string&, unsigned int)>& visit) const
+{
+    Node leaf;
+    FindLeaf(bm, from, leaf);
+    while(true)
+    {
+        for(const auto& rec : leaf.records)
+        {
+            if(rec.first >= from && !visit(rec.first, rec.second))
+                return true;
+        }
+        if(leaf.link == 0)
+            return true;
+        leaf = ReadNode(bm, leaf.link);
+    }
+}
+
+unsigned int BTreeIndex::GetInodeBlock() const
+{
+    return inode_block;
+}
+
+bool BTreeIndex::Init(BlockManager& bm)
+{
+    // node 0 holds the header, the root starts out as an empty leaf
+    hdr = { 1, 1, 1 };
+    return AppendNode(bm, Node()) != 0 && SaveHeader(bm);
+}
+
+bool BTreeIndex::InsertInto(BlockManager& bm, unsigned int node_id, 
+    const std::string& key, unsigned int ref, Split& split)
+{
+    Node node = ReadNode(bm, node_id);
+    // index of the first record with a larger key
+    const size_t pos = std::upper_bound(node.records.begin(), node.records.end(), key, 
+        [](const std::string& key, const auto& rec) { return key < rec.first; }) - node.records.begin();
+    if(node.is_leaf)
+    {
+        node.records.insert(node.records.begin() + pos, { key, ref });
+    }
+    else
+    {
+        const unsigned int child = pos == 0 ? node.link : node.records[pos - 1].second;
+        Split child_split;
+        if(!InsertInto(bm, child, key, ref, child_split))
+            return false; // nothing changed in this node
+        node.records.insert(node.records.begin() + pos, { child_split.key, child_split.node });
+    }
+
+    unsigned int size = sizeof(NodeHeader);
+    for(const auto& rec : node.records)
+        size += RecordSize(rec);
+    if(size <= NodeSize)
+    {
+        WriteNode(bm, node_id, node);
+        return false;
+    }
+
+    // split so the left node keeps about half of the bytes
+    // a record is well under half a node, so both halves get at least one
+    size_t mid = 0;
+    for(unsigned int left_size = sizeof(NodeHeader); left_size < size / 2; mid++)
+        left_size += RecordSize(node.records[mid]);
+
+    Node right;
+    right.is_leaf = node.is_leaf;
+    if(node.is_leaf)
+    {
+        right.records.assign(node.records.begin() + mid, node.records.end());
+        right.link = node.link;
+        split.key = right.records.front().first;
+        split.node = AppendNode(bm, right);
+        node.link = split.node;
+    }
+    else
+    {
+        // the middle key moves up, its child becomes the right node's first
+        right.records.assign(node.records.begin() + mid + 1, node.records.end());
+        right.link = node.records[mid].second;
+        split.key = node.records[mid].first;
+        split.node = AppendNode(bm, right);
+    }
+    node.records.resize(mid);
+    WriteNode(bm, node_id, node);
+    return true;
+}
+
+unsigned int BTreeIndex::FindLeaf(const BlockManager& bm, const std::string& key, Node& leaf) const
+{
+    unsigned int node_id = hdr.root;
+    leaf = ReadNode(bm, node_id);
+    while(!leaf.is_leaf)
+    {
+        // follow the last child whose smallest key is not larger than the key
+        node_id = leaf.link;
+        for(const auto& rec : leaf.records)
+        {
+            if(key < rec.first)
+                break;
+            node_id = rec.second;
+        }
+        leaf = ReadNode(bm, node_id);
+    }
+    return node_id;
+}
+
+BTreeIndex::Node BTreeIndex::ReadNode(const BlockManager& bm, unsigned int node_id) const
+{
+    char buf[NodeSize];
+    inode.Read(bm, node_id * NodeSize, buf, NodeSize);
+
+    NodeHeader nh;
+    memcpy(&nh, buf, sizeof(NodeHeader));
+    Node node;
+    node.is_leaf = nh.is_leaf;
+    node.link = nh.link;
+    node.records.resize(nh.num_records);
+    unsigned int pos = sizeof(NodeHeader);
+    for(auto& rec : node.records)
+    {
+        memcpy(&rec.second, buf + pos, sizeof(unsigned int));
+        const unsigned char len = buf[pos + sizeof(unsigned int)];
+        rec.first.assign(buf + pos + sizeof(unsigned int) + 1, len);
+        pos += sizeof(unsigned int) + 1 + len;
+    }
+    return node;
+}
+
+bool BTreeIndex::WriteNode(BlockManager& bm, unsigned int node_id, const Node& node)
+{
+    char buf[NodeSize];
+    NodeHeader nh = { node.is_leaf, 0, (unsigned short)node.records.size(), node.link };
+    memcpy(buf, &nh, sizeof(NodeHeader));
+    unsigned int pos = sizeof(NodeHeader);
+    for(const auto& rec : node.records)
+    {
+        memcpy(buf + pos, &rec.second, sizeof(unsigned int));
+        buf[pos + sizeof(unsigned int)] = (unsigned char)rec.first.size();
+        memcpy(buf + pos + sizeof(unsigned int) + 1, rec.first.data(), rec.first.size());
+        pos += RecordSize(rec);
+    }
+    // only the used part is written, the rest of the node is never read
+    return inode.Write(bm, inode_block, node_id * NodeSize, buf, pos) == pos;
+}
+
+unsigned int BTreeIndex::AppendNode(BlockManager& bm, const Node& node)
+{
+    if(!WriteNode(bm, hdr.num_nodes, node))
+        return 0;
+    return hdr.num_nodes++;
+}
+
+bool BTreeIndex::SaveHeader(BlockManager& bm)
+{
+    return inode.Write(bm, inode_block, 0, &hdr, sizeof(Header)) == sizeof(Header);
+}
+
+unsigned int BTreeIndex::RecordSize(const std::pair<std::string, unsigned int>& rec)
+{
+    return sizeof(unsigned int) + 1 + rec.first.size();
+}
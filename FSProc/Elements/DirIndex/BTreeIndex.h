@@ -0,0 +1,91 @@
+#pragma once
+
+#include <DirIndex.h>
+#include <Inode.h>
+#include <vector>
+
+namespace FS
+{
+    // on-disk B+tree keyed by entry name
+    // names are kept sorted in linked leaves, so a listing can start from any name
+    // and a scan over a prefix only reads the leaves holding it
+    // nodes are never merged, leaves emptied by removals stay in the chain until Clear
+	class BTreeIndex : public DirIndex
+	{
+        // two blocks, so a node holds at least three of the longest names
+        static constexpr unsigned int NodeSize = 2 * Disk::BlockSize;
+        // kept in node 0
+        struct Header
+        {
+            unsigned int root;
+            unsigned int num_nodes;
+            unsigned int height;
+        };
+        // start of every node on disk, followed by the records
+        // a record is the value (4 bytes), the key length (1 byte) and the key
+        struct NodeHeader
+        {
+            unsigned char is_leaf;
+            unsigned char unused;
+            unsigned short num_records;
+            unsigned int link;
+        };
+        // a node read into memory
+        struct Node
+        {
+            bool is_leaf = true;
+            // leaf: the next leaf (0 for the last one)
+            // internal: the child holding the keys less than the first record's key
+            unsigned int link = 0;
+            // leaf: names and their refs
+            // internal: the smallest key of a child and the child
+            std::vector<std::pair<std::string, unsigned int>> records;
+        };
+        // the key and node split off from a node that overflowed
+        struct Split
+        {
+            std::string key;
+            unsigned int node;
+        };
+	public:
+        // an index with no storage, use Create or Load to get a usable one
+        BTreeIndex() = default;
+        // create a tree with a single empty leaf in a newly allocated inode
+        // the inode block is 0 if there was no space for it
+        static BTreeIndex Create(BlockManager& bm);
+        // load the tree stored at the given inode block
+        static BTreeIndex Load(const BlockManager& bm, unsigned int inode_block);
+
+        unsigned int Find(const BlockManager& bm, const std::string& name, 
+            const std::function<bool(unsigned int)>& matches) const override;
+        bool Insert(BlockManager& bm, const std::string& name, unsigned int ref) override;
+        void Erase(BlockManager& bm, const std::string& name, unsigned int ref) override;
+        void Clear(BlockManager& bm) override;
+        void Free(BlockManager& bm) override;
+        void CollectBlocks(const BlockManager& bm, std::vector<unsigned int>& block_nums) const override;
+        bool Scan(const BlockManager& bm, const std::string& from, 
+            const std::function<bool(const std::string&, unsigned int)>& visit) const override;
+
+        unsigned int GetInodeBlock() const override;
+
+    private:
+        // reset the tree to a single empty leaf, returns false if there was no space for it
+        bool Init(BlockManager& bm);
+        // insert into the subtree under node_id, returns true if the node was split
+        bool InsertInto(BlockManager& bm, unsigned int node_id, const std::string& key, unsigned int ref, Split& split);
+        // get the leaf the key belongs in
+        unsigned int FindLeaf(const BlockManager& bm, const std::string& key, Node& leaf) const;
+        Node ReadNode(const BlockManager& bm, unsigned int node_id) const;
+        // returns false if a block of the node couldn't be allocated
+        bool WriteNode(BlockManager& bm, unsigned int node_id, const Node& node);
+        // write a node at the end of the tree and return its id, 0 if it couldn't be written
+        unsigned int AppendNode(BlockManager& bm, const Node& node);
+        bool SaveHeader(BlockManager& bm);
+        static unsigned int RecordSize(const std::pair<std::string, unsigned int>& rec);
+
+	private:
+        Inode inode;
+        unsigned int inode_block = 0;
+        Header hdr = {};
+	};
+}
@@ -0,0 +1,31 @@
+#include "DirIndex.h"
+#include "HashIndex.h"
+#include "BTreeIndex.h"
+using namespace FS;
+
+std::unique_ptr<DirIndex> DirIndex::Create(BlockManager& bm, DirFormat format)
+{
+    std::unique_ptr<DirIndex> index;
+    if(format == DirFormat::BTree)
+        index = std::make_unique<BTreeIndex>(BTreeIndex::Create(bm));
+    else
+        index = std::make_unique<HashIndex>(HashIndex::Create(bm));
+
+    if(index->GetInodeBlock() == 0)
+        index.reset();
+    return index;
+}
+
+std::unique_ptr<DirIndex> DirIndex::Load(const BlockManager& bm, DirFormat format, unsigned int inode_block)
+{
+    if(format == DirFormat::BTree)
+        return std::make_unique<BTreeIndex>(BTreeIndex::Load(bm, inode_block));
+    return std::make_unique<HashIndex>(HashIndex::Load(bm, inode_block));
+}
+
+bool DirIndex::Scan(const BlockManager&, const std::string&, 
+    const std::function<bool(const std::string&, unsigned int)>&) const
+{
+    // unordered unless an index says otherwise
+    return false;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <BlockManager.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace FS
+{
+    // maps the names in a directory to refs (offsets) of their entries
+    // each index keeps its data in an inode of its own
+	class DirIndex
+	{
+	public:
+        virtual ~DirIndex() = default;
+        // create an empty index of the given format, null if there was no space for it
+        static std::unique_ptr<DirIndex> Create(BlockManager& bm, DirFormat format);
+        // load the index of the given format stored at the inode block
+        static std::unique_ptr<DirIndex> Load(const BlockManager& bm, DirFormat format, unsigned int inode_block);
+
+        // get the ref stored for the given name, 0 if there is none
+        // matches is called with candidate refs for indexes that don't store names themselves
+        virtual unsigned int Find(const BlockManager& bm, const std::string& name, 
+            const std::function<bool(unsigned int)>& matches) const = 0;
+        // store a ref (must not be 0) for a name that is not in the index yet
+        // returns false if the index is full
+        virtual bool Insert(BlockManager& bm, const std::string& name, unsigned int ref) = 0;
+        // remove the ref stored for the given name
+        virtual void Erase(BlockManager& bm, const std::string& name, unsigned int ref) = 0;
+        // remove every ref
+        virtual void Clear(BlockManager& bm) = 0;
+        // free every block of the index, including its inode
+        virtual void Free(BlockManager& bm) = 0;
+        // append every block of the index (including its inode) to block_nums instead of freeing them
+        virtual void CollectBlocks(const BlockManager& bm, std::vector<unsigned int>& block_nums) const = 0;
+        // call visit with every name not less than from (and its ref) in sorted order until it returns false
+        // returns false without visiting anything if the index doesn't keep names in order
+        virtual bool Scan(const BlockManager& bm, const std::string& from, 
+            const std::function<bool(const std::string&, unsigned int)>& visit) const;
+
+        virtual unsigned int GetInodeBlock() const = 0;
+	};
+}
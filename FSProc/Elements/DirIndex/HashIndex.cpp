@@ -0,0 +1,198 @@
+#include "HashIndex.h"
+using namespace FS;
+
+#include <vector>
+
+HashIndex HashIndex::Create(BlockManager& bm)
+{
+    HashIndex index;
+    index.inode_block = bm.AlloateFreeBlock();
+    if(index.inode_block == 0)
+        return index;
+    index.inode = Inode::Create(bm, index.inode_block, ElementType::Index, 0, 0);
+    // the slots start out as a hole, which reads as empty slots
+    index.hdr.capacity = InitialCapacity;
+    index.inode.Truncate(bm, index.inode_block, (InitialCapacity + 1) * sizeof(Slot));
+    if(!index.SaveHeader(bm))
+        index.Free(bm);
+    return index;
+}
+
+HashIndex HashIndex::Load(const BlockManager& bm, unsigned int inode_block)
+{
+    HashIndex index;
+    index.inode_block = inode_block;
+    index.inode = Inode::Load(bm, inode_block);
+    index.inode.Read(bm, 0, &index.hdr, sizeof(Header));
+    return index;
+}
+
+unsigned int HashIndex::Find(const BlockManager& bm, const std::string& name, 
+    const std::function<bool(unsigned int)>& matches) const
+{
+    if(hdr.capacity == 0)
+        return 0;
+
+    const unsigned int hash = Hash(name);
+    Slot buf[SlotsPerBlock];
+    unsigned int loaded_block = ~0u;
+    // follow the probe sequence until an empty slot, removed slots don't end it
+    for(unsigned int n = 0, i = hash % hdr.capacity; n < hdr.capacity; n++, i = (i + 1) % hdr.capacity)
+    {
+        const Slot s = ReadSlot(bm, i, buf, loaded_block);
+        if(s.ref == EmptyRef)
+            break;
+        if(s.ref != RemovedRef && s.hash == hash && matches(s.ref))
+            return s.ref;
+    }
+    return 0;
+}
+
+bool HashIndex::Insert(BlockManager& bm, const std::string& name, unsigned int ref)
+{
+    // keep the table at most half full so probe sequences stay short
+    if((hdr.num_used + 1) * 2 > hdr.capacity)
+    {
+        const unsigned int new_capacity = (hdr.capacity + 1) * 2 - 1;
+        if(!Rehash(bm, new_capacity) && hdr.num_used + 1 >= hdr.capacity)
+            return false;
+    }
+    return Place(bm, Hash(name), ref);
+}
+
+void HashIndex::Erase(BlockManager& bm, const std::string& name, unsigned int ref)
+{
+    const unsigned int hash = Hash(name);
+    Slot buf[SlotsPerBlock];
+    unsigned int loaded_block = ~0u;
+    for(unsigned int n = 0, i = hash % hdr.capacity; n < hdr.capacity; n++, i = (i + 1) % hdr.capacity)
+    {
+        const Slot s = ReadSlot(bm, i, buf, loaded_block);
+        if(s.ref == EmptyRef)
+            return;
+        if(s.ref == ref)
+        {
+            // the slot can't go back to empty without breaking the probe sequences running through it
+            WriteSlot(bm, i, { hash, RemovedRef });
+            return;
+        }
+    }
+}
+
+void HashIndex::Clear(BlockManager& bm)
+{
+    inode.Truncate(bm, inode_block, 0);
+    hdr = { InitialCapacity, 0 };
+    inode.Truncate(bm, inode_block, (InitialCapacity + 1) * sizeof(Slot));
+    SaveHeader(bm);
+}
+
+void HashIndex::Free(BlockManager& bm)
+{
+    if(inode_block == 0)
+        return;
+    inode.FreeAll(bm, inode_block);
+    bm.FreeBlock(inode_block);
+    inode_block = 0;
+    hdr = {};
+}
+
+void HashIndex::CollectBlocks(const BlockManager& bm, std::vector<unsigned int>& block_nums) const
+{
+    if(inode_block == 0)
+        return;
+    inode.CollectBlocks(bm, block_nums);
+    block_nums.push_back(inode_block);
+}
+
+unsigned int HashIndex::GetInodeBlock() const
+{
+    return inode_block;
+}
+
+unsigned int HashIndex::Hash(const std::string& name)
+{
+    // 32 bit FNV-1a
+    unsigned int hash = 2166136261u;
+    for(unsigned char c : name)
+    {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool HashIndex::Rehash(BlockManager& bm, unsigned int new_capacity)
+{
+    if((new_capacity + 1) * sizeof(Slot) > Inode::MaxSize)
+        return false;
+
+    // collect the live slots (this drops the removed ones)
+    std::vector<Slot> live;
+    Slot buf[SlotsPerBlock];
+    unsigned int loaded_block = ~0u;
+    for(unsigned int i = 0; i < hdr.capacity; i++)
+    {
+        const Slot s = ReadSlot(bm, i, buf, loaded_block);
+        if(s.ref != EmptyRef && s.ref != RemovedRef)
+            live.push_back(s);
+    }
+
+    // the table is rebuilt in the same inode so whoever stores the inode block doesn't need updating
+    // every block of the new table is allocated before the old one is touched, so placing the refs can't fail
+    if(!inode.Preallocate(bm, inode_block, 0, (new_capacity + 1) * sizeof(Slot)))
+        return false;
+    // the new blocks are zeroed (empty slots) already, only the old table has to be cleared
+    const std::vector<char> zeros((hdr.capacity + 1) * sizeof(Slot), 0);
+    inode.Write(bm, inode_block, 0, zeros.data(), zeros.size());
+    hdr = { new_capacity, 0 };
+    for(const Slot& s : live)
+        Place(bm, s.hash, s.ref);
+    SaveHeader(bm);
+    return true;
+}
+
+bool HashIndex::Place(BlockManager& bm, unsigned int hash, unsigned int ref)
+{
+    Slot buf[SlotsPerBlock];
+    unsigned int loaded_block = ~0u;
+    for(unsigned int i = hash % hdr.capacity; ; i = (i + 1) % hdr.capacity)
+    {
+        const Slot s = ReadSlot(bm, i, buf, loaded_block);
+        if(s.ref == EmptyRef || s.ref == RemovedRef)
+        {
+            if(!WriteSlot(bm, i, { hash, ref }))
+                return false;
+            if(s.ref == EmptyRef)
+            {
+                hdr.num_used++;
+                SaveHeader(bm);
+            }
+            return true;
+        }
+    }
+}
+
+HashIndex::Slot HashIndex::ReadSlot(const BlockManager& bm, unsigned int idx, 
+    Slot* buf, unsigned int& loaded_block) const
+{
+    // slot 0 on disk is the header
+    const unsigned int pos = (idx + 1) * sizeof(Slot);
+    const unsigned int block = pos / Disk::BlockSize;
+    if(block != loaded_block)
+    {
+        inode.Read(bm, block * Disk::BlockSize, buf, Disk::BlockSize);
+        loaded_block = block;
+    }
+    return buf[(pos % Disk::BlockSize) / sizeof(Slot)];
+}
+
+bool HashIndex::WriteSlot(BlockManager& bm, unsigned int idx, const Slot& s)
+{
+    return inode.Write(bm, inode_block, (idx + 1) * sizeof(Slot), &s, sizeof(Slot)) == sizeof(Slot);
+}
+
+bool HashIndex::SaveHeader(BlockManager& bm)
+{
+    return inode.Write(bm, inode_block, 0, &hdr, sizeof(Header)) == sizeof(Header);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <DirIndex.h>
+#include <Inode.h>
+
+namespace FS
+{
+    // on-disk hash table (open addressing) mapping entry names to where their entries are stored
+    // the table is kept in its own inode and at most half full, so finding, adding or removing
+    // an entry touches a constant number of blocks on average
+	class HashIndex : public DirIndex
+	{
+        struct Slot
+        {
+            unsigned int hash;
+            unsigned int ref;
+        };
+        // stored in place of the first slot
+        struct Header
+        {
+            unsigned int capacity;
+            unsigned int num_used; // live and removed slots, only cleared by a rehash
+        };
+
+        static constexpr unsigned int SlotsPerBlock = Disk::BlockSize / sizeof(Slot);
+        // capacity of a new index (fills exactly one block along with the header)
+        static constexpr unsigned int InitialCapacity = SlotsPerBlock - 1;
+        // refs with special meanings, 0 is never a valid ref
+        static constexpr unsigned int EmptyRef = 0;
+        static constexpr unsigned int RemovedRef = ~0u;
+	public:
+        // an index with no storage, use Create or Load to get a usable one
+        HashIndex() = default;
+        // create an empty index in a newly allocated inode
+        // the inode block is 0 if there was no space for it
+        static HashIndex Create(BlockManager& bm);
+        // load the index stored at the given inode block
+        static HashIndex Load(const BlockManager& bm, unsigned int inode_block);
+
+        // get the ref stored for the given name, 0 if there is none
+        // matches is called with each ref stored under the same hash to check if it is actually the name
+        unsigned int Find(const BlockManager& bm, const std::string& name, 
+            const std::function<bool(unsigned int)>& matches) const override;
+        // store a ref (must not be 0) for a name that is not in the index yet
+        // returns false if the index is full and can't grow
+        bool Insert(BlockManager& bm, const std::string& name, unsigned int ref) override;
+        // remove the ref stored for the given name
+        void Erase(BlockManager& bm, const std::string& name, unsigned int ref) override;
+        // remove every ref, the index shrinks back to its initial capacity
+        void Clear(BlockManager& bm) override;
+        // free every block of the index, including its inode
+        void Free(BlockManager& bm) override;
+        void CollectBlocks(const BlockManager& bm, std::vector<unsigned int>& block_nums) const override;
+
+        unsigned int GetInodeBlock() const override;
+
+    private:
+        static unsigned int Hash(const std::string& name);
+        // resize the table to the given capacity, rehashing all live refs
+        // the old table is left as it is if there is no space for the new one
+        bool Rehash(BlockManager& bm, unsigned int new_capacity);
+        // store a ref in the first unused slot of its probe sequence
+        // returns false if there was no space for the block the slot is in
+        bool Place(BlockManager& bm, unsigned int hash, unsigned int ref);
+        // read a slot, buf caches the block of slots it is in (loaded_block is its index)
+        Slot ReadSlot(const BlockManager& bm, unsigned int idx, Slot* buf, unsigned int& loaded_block) const;
+        bool WriteSlot(BlockManager& bm, unsigned int idx, const Slot& s);
+        bool SaveHeader(BlockManager& bm);
+
+	private:
+        Inode inode;
+        unsigned int inode_block = 0;
+        Header hdr = {};
+	};
+}
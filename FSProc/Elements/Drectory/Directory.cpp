@@ -1,180 +1,695 @@
-#include "Directory.h"
-#include "File.h"
-#include <string.h>
-
-using namespace FS;
-
-Directory::Directory(BlockManager& bm, unsigned int inode_block)
-    :
-    FSElement(bm, inode_block)
-{
-    inode.Read(bm, 0, &num_entries, sizeof(int));
-    inode.UpdateTimeAccessed(bm, inode_block);
-}
-
-Directory::Directory(BlockManager& bm, int owner, int permissions)
-    :
-    FSElement(bm, ElementType::Directory, owner, permissions)
-{
-    inode.Write(bm, inode_block, 0, &num_entries, sizeof(int));
-}
-
-DirPtr Directory::Load(BlockManager& bm, unsigned int inode_block)
-{
-    return std::make_unique<Directory>(Directory(bm, inode_block));
-}
-
-DirPtr Directory::LoadRoot(BlockManager& bm)
-{
-    if(bm.FirstAllocatableBlock() == bm.GetFreeBlock()) // root is kept at the first allocatable block
-        return DirPtr(); // if the first allocatable block is free, there is no root. return empty ptr to indicate this
-    return Load(bm, bm.FirstAllocatableBlock()); // load the root block and return it
-}
-
-DirPtr Directory::CreateRoot(BlockManager& bm, int root_uid, int rootdir_permissions)
-{
-    // create a root block and return it
-    return std::make_unique<Directory>(Directory(bm, root_uid, rootdir_permissions));
-}
-
-bool Directory::Add(BlockManager& bm, const char* name, ElementType t, int owner, int permissions)
-{
-    if(EntryExists(bm, name)) // stop if the entry alrady exists
-        return false;
-
-    BeginWrite(bm); // write mode
-
-    Entry e;
-    // check the given element type and create the appropriate element
-    // and store the block number it was saved to
-    if(t == ElementType::Directory)
-        e.block_num = Directory(bm, owner, permissions).inode_block;
-    else
-        e.block_num = File(bm, owner, permissions).inode_block;
-    
-    // if the block num is 0, it failed
-    if(e.block_num == 0)
-    {
-        EndWrite();
-        return false;
-    }
-    
-    // copy the entry name and save it
-    strncpy(e.name, name, MaxNameLen);
-    inode.Write(bm, inode_block, inode.GetSize(), &e, sizeof(Entry));
-    num_entries++;
-    inode.Write(bm, inode_block, 0, &num_entries, sizeof(int));
-
-    EndWrite();
-    return true;
-}
-
-unsigned int Directory::GetNumEntries() const
-{
-    BeginRead();
-    int num = num_entries;
-    EndRead();
-
-    return num;
-}
-
-std::vector<std::string> FS::Directory::List(BlockManager& bm) const
-{
-    BeginRead(bm);
-
-    std::vector<std::string> entries(num_entries);
-    int offset = sizeof(num_entries); // start at offset num entries
-    // iterate over all entries and add them to the vector
-    for (int i = 0; i < num_entries; i++)
-    {
-        Entry e = GetEntry(bm, i);
-        entries[i] = e.name;
-        offset += sizeof(Entry);
-    }
-
-    EndRead();
-
-    return entries;
-}
-
-FSElementPtr Directory::Open(BlockManager& bm, const std::string& filename)
-{
-    Entry* entry_list = new Entry[num_entries];
-    FSElementPtr ptr;
-    
-    BeginRead(bm);
-    // read the entire entry list
-    inode.Read(bm, sizeof(int), entry_list, sizeof(Entry) * num_entries);
-    // iterate over entry list to find the correct one
-    for(int i = 0; i < num_entries; i++)
-    {
-        if(entry_list[i].name == filename)
-        {
-            Inode child_inode = Inode::Load(bm, entry_list[i].block_num);
-            // load the appropriate type of element based on the element type
-            if(child_inode.GetType() == ElementType::File)
-            {
-                ptr = File::Load(bm, entry_list[i].block_num);
-                break;
-            }
-            else if(child_inode.GetType() == ElementType::Directory)
-            {
-                ptr = Directory::Load(bm, entry_list[i].block_num);
-                break;
-            }
-        }
-    }
-    EndRead();
-
-    delete[] entry_list;
-    return ptr; // returns null if nothing was found
-}
-
-void Directory::Remove(BlockManager& bm, const std::string& filename)
-{
-    BeginWrite();
-    Entry* entry_list = new Entry[num_entries - 1];
-    int count = 0;
-    for(int i = 0; i < num_entries; i++)
-    {
-        Entry e = GetEntry(bm, i);
-        if(e.name != filename)
-        {
-            entry_list[count++] = e;
-        }
-    }
-
-    num_entries--;
-
-    inode.FreeAll(bm, inode_block);
-    inode.Write(bm, inode_block, 0, &num_entries, sizeof(int));
-    inode.Write(bm, inode_block, sizeof(int), entry_list, sizeof(Entry) * num_entries);
-
-    delete[] entry_list;
-    EndWrite();
-}
-
-Directory::Entry Directory::GetEntry(const BlockManager& bm, unsigned int idx) const
-{
-    Entry e;
-    // read the entry by generating its offset using the index
-    inode.Read(bm, sizeof(int) + idx * sizeof(Entry), &e, sizeof(Entry));
-    return e;
-}
-
-bool Directory::EntryExists(const BlockManager& bm, const std::string& filename)
-{
-    return GetEntryIdx(bm, filename) != -1;
-}
-
-int Directory::GetEntryIdx(const BlockManager& bm, const std::string& filename) const
-{
-    for(int i = 0; i < num_entries; i++)
-    {
-        if(GetEntry(bm, i).name == filename)
-        {
-            return i;
-        }
-    }
-    return -1;
-}
\ No newline at end of file
+#include "Directory.h"
+#include "File.h"
+#include <algorithm>
+#include <cstddef>
+#include <string.h>
+#include <unordered_set>
+
+using namespace FS;
+
+Directory::Directory(BlockManager& bm, unsigned int inode_block)
+    :
+    FSElement(bm, inode_block)
+{
+    inode.Read(bm, 0, &hdr, sizeof(Header));
+    index = DirIndex::Load(bm, hdr.format, hdr.index_block);
+}
+
+Directory::Directory(BlockManager& bm, int owner, int permissions, unsigned int block_num)
+    :
+    FSElement(bm, ElementType::Directory, owner, permissions, block_num)
+{
+    if(inode_block == 0)
+        return;
+    hdr.format = bm.GetMountOptions().dir_format;
+    index = DirIndex::Create(bm, hdr.format);
+    // a directory can't be used without its index
+    if(!index)
+    {
+        bm.FreeBlock(inode_block);
+        inode_block = 0;
+        return;
+    }
+    hdr.index_block = index->GetInodeBlock();
+    hdr.end = sizeof(Header);
+    // or without its header, which is the first thing in a block of its own
+    if(inode.Write(bm, inode_block, 0, &hdr, sizeof(Header)) != sizeof(Header))
+    {
+        index->Free(bm);
+        index.reset();
+        bm.FreeBlock(inode_block);
+        inode_block = 0;
+        return;
+    }
+    Publish();
+}
+
+DirPtr Directory::Load(BlockManager& bm, unsigned int inode_block)
+{
+    return std::make_unique<Directory>(Directory(bm, inode_block));
+}
+
+DirPtr Directory::LoadRoot(BlockManager& bm)
+{
+    if(bm.FirstAllocatableBlock() == bm.GetFreeBlock()) // root is kept at the first allocatable block
+        return DirPtr(); // if the first allocatable block is free, there is no root. return empty ptr to indicate this
+    return Load(bm, bm.FirstAllocatableBlock()); // load the root block and return it
+}
+
+DirPtr Directory::CreateRoot(BlockManager& bm, int root_uid, int rootdir_permissions)
+{
+    // create a root block and return it
+    return std::make_unique<Directory>(Directory(bm, root_uid, rootdir_permissions));
+}
+
+bool Directory::Add(BlockManager& bm, const char* name, ElementType t, int owner, int permissions)
+{
+    BeginWrite(bm); // write mode
+
+    // checked under the lock, so nobody can add the same name in between
+    // a removed directory's blocks may already be reused, nothing is added to it
+    if(!isValid || EntryExists(bm, name)) // stop if the entry alrady exists
+    {
+        EndWrite();
+        return false;
+    }
+
+    Entry e;
+    // check the given element type and create the appropriate element
+    // and store the block number it was saved to
+    if(t == ElementType::Directory)
+        e.block_num = Directory(bm, owner, permissions).inode_block;
+    else
+        e.block_num = File(bm, owner, permissions).inode_block;
+    e.type = t == ElementType::Directory ? ElementType::Directory : ElementType::File;
+    
+    // if the block num is 0, it failed
+    if(e.block_num == 0)
+    {
+        EndWrite();
+        return false;
+    }
+    
+    if(!AppendEntry(bm, e.block_num, e.type, name))
+    {
+        // the index is full, the new element is not reachable so it is freed again
+        FSElementPtr child = LoadEntry(bm, e.block_num, e.type);
+        child->FreeDatablocks(bm);
+        child->FreeInodeBlock(bm);
+        EndWrite();
+        return false;
+    }
+
+    EndWrite();
+    return true;
+}
+
+std::vector<bool> Directory::AddMany(BlockManager& bm, const std::vector<NewEntry>& entries, int owner)
+{
+    std::vector<bool> added(entries.size(), false);
+    BeginWrite(bm); // write mode, the times are only updated once
+    if(!isValid)
+    {
+        EndWrite();
+        return added;
+    }
+
+    // every name is checked under the same lock, a name given more than once is only added the first time
+    std::vector<size_t> to_add;
+    std::unordered_set<std::string> names;
+    for(size_t i = 0; i < entries.size(); i++)
+    {
+        const std::string name = entries[i].name.substr(0, MaxNameLen);
+        if(FindEntry(bm, name) == 0 && names.insert(name).second)
+            to_add.push_back(i);
+    }
+
+    // the records and index entries go in first, so the inodes can only take the space that is left
+    // their records don't point at an element until the inodes are allocated, nobody sees them before that
+    std::vector<unsigned int> offsets;
+    for(size_t i : to_add)
+    {
+        const ElementType type = entries[i].type == ElementType::Directory ? ElementType::Directory : ElementType::File;
+        const unsigned int offset = InsertEntry(bm, 0, type, entries[i].name.c_str());
+        if(offset == 0)
+            break; // no room for the rest
+        offsets.push_back(offset);
+        // every entry placed needs a block for its inode too, the rest are left out once they are all spoken for
+        if(bm.GetNumFreeBlocks() <= offsets.size())
+            break;
+    }
+
+    // the inodes are allocated together, so the superblock is written once
+    // if there isn't room for all of them, the entries at the end are left out
+    std::vector<unsigned int> inode_blocks;
+    bm.AllocateBlocks(std::min<size_t>(offsets.size(), bm.GetNumFreeBlocks()), inode_blocks);
+    for(size_t j = 0; j < offsets.size(); j++)
+    {
+        const NewEntry& ne = entries[to_add[j]];
+        unsigned int block_num = 0;
+        if(j < inode_blocks.size() && ne.type == ElementType::Directory)
+            block_num = Directory(bm, owner, ne.permissions, inode_blocks[j]).inode_block;
+        else if(j < inode_blocks.size())
+            block_num = File(bm, owner, ne.permissions, inode_blocks[j]).inode_block;
+        // the inode block has been freed again if a directory had no room for its index
+        if(block_num == 0)
+        {
+            EraseEntry(bm, offsets[j], ne.name.substr(0, MaxNameLen));
+            continue;
+        }
+        // the record's block is allocated already, so this can't come up short
+        inode.Write(bm, inode_block, offsets[j] + offsetof(RecordHeader, block_num), &block_num, sizeof(unsigned int));
+        added[to_add[j]] = true;
+    }
+    // the header is written once for the whole batch
+    inode.Write(bm, inode_block, 0, &hdr, sizeof(Header));
+
+    EndWrite();
+    return added;
+}
+
+bool Directory::Clone(BlockManager& bm, const char* name, const File& src, int owner)
+{
+    BeginWrite(bm); // write mode
+
+    if(!isValid || EntryExists(bm, name)) // stop if the entry alrady exists
+    {
+        EndWrite();
+        return false;
+    }
+
+    // the clone only copies src's inode, its data blocks are shared
+    const unsigned int block_num = File(bm, src, owner).inode_block;
+    if(block_num == 0)
+    {
+        EndWrite();
+        return false;
+    }
+
+    if(!AppendEntry(bm, block_num, ElementType::File, name))
+    {
+        FSElementPtr clone = LoadEntry(bm, block_num, ElementType::File);
+        clone->FreeDatablocks(bm);
+        clone->FreeInodeBlock(bm);
+        EndWrite();
+        return false;
+    }
+
+    EndWrite();
+    return true;
+}
+
+bool Directory::AppendEntry(BlockManager& bm, unsigned int block_num, ElementType type, const char* name)
+{
+    const bool res = InsertEntry(bm, block_num, type, name) != 0;
+    inode.Write(bm, inode_block, 0, &hdr, sizeof(Header));
+    return res;
+}
+
+unsigned int Directory::InsertEntry(BlockManager& bm, unsigned int block_num, ElementType type, const char* name)
+{
+    Entry e;
+    e.block_num = block_num;
+    e.type = type;
+    e.name.assign(name, strnlen(name, MaxNameLen));
+
+    unsigned int rec_len;
+    const unsigned int offset = PlaceRecord(bm, RecordSize(e.name), rec_len);
+    // the record is written first, it's what may need a new block
+    if(!WriteRecord(bm, offset, rec_len, e))
+    {
+        // only a record appended at the end can start a block that isn't allocated yet
+        if(offset + rec_len == hdr.end)
+            hdr.end = offset;
+        else
+            FreeRecordAt(bm, offset, rec_len);
+        return 0;
+    }
+    if(!index->Insert(bm, e.name, offset))
+    {
+        FreeRecordAt(bm, offset, rec_len);
+        return 0;
+    }
+    hdr.num_entries++;
+    return offset;
+}
+
+unsigned int Directory::GetNumEntries() const
+{
+    BeginRead();
+    int num = hdr.num_entries;
+    EndRead();
+
+    return num;
+}
+
+std::vector<std::string> FS::Directory::List(BlockManager& bm) const
+{
+    BeginRead(bm);
+
+    std::vector<std::string> entries;
+    entries.reserve(hdr.num_entries);
+    // iterate over all entries and add them to the vector
+    ForEachEntry(bm, [&](unsigned int, const Entry& e) {
+        entries.push_back(e.name);
+        return true;
+    });
+
+    EndRead();
+
+    return entries;
+}
+
+std::vector<Directory::EntryInfo> Directory::ListPlus(BlockManager& bm) const
+{
+    BeginRead(bm);
+
+    std::vector<EntryInfo> entries;
+    std::vector<unsigned int> block_nums;
+    entries.reserve(hdr.num_entries);
+    block_nums.reserve(hdr.num_entries);
+    ForEachEntry(bm, [&](unsigned int, const Entry& e) {
+        entries.push_back({ e.name, {}, e.block_num });
+        block_nums.push_back(e.block_num);
+        return true;
+    });
+    // still in read mode so none of the elements can be removed halfway through
+    const auto metadata = Inode::LoadMetadata(bm, block_nums);
+    for(size_t i = 0; i < entries.size(); i++)
+        entries[i].metadata = metadata[i];
+
+    EndRead();
+
+    return entries;
+}
+
+long long Directory::ListPage(BlockManager& bm, long long cookie, 
+    const std::function<bool(const std::string&)>& fits, std::vector<EntryInfo>& page) const
+{
+    BeginRead(bm);
+
+    // the cookie is the offset of the next record, tagged with the generation it belongs to
+    unsigned int from = (unsigned int)cookie;
+    if(cookie == 0)
+    {
+        from = sizeof(Header);
+    }
+    else if((unsigned int)(cookie >> 32) != hdr.generation || from < sizeof(Header) || from > hdr.end)
+    {
+        EndRead();
+        return -2;
+    }
+
+    std::vector<unsigned int> block_nums;
+    const unsigned int next = ForEachEntry(bm, [&](unsigned int, const Entry& e) {
+        if(!fits(e.name))
+            return false;
+        page.push_back({ e.name, {}, e.block_num });
+        block_nums.push_back(e.block_num);
+        return true;
+    }, from);
+    const auto metadata = Inode::LoadMetadata(bm, block_nums);
+    for(size_t i = 0; i < page.size(); i++)
+        page[i].metadata = metadata[i];
+
+    const long long next_cookie = ((long long)hdr.generation << 32) | next;
+    EndRead();
+
+    return next_cookie;
+}
+
+std::vector<std::string> Directory::List(BlockManager& bm, const std::string& resume_after, 
+    unsigned int max_entries, const std::string& prefix) const
+{
+    std::vector<std::string> names;
+    if(max_entries == 0)
+        return names;
+
+    BeginRead(bm);
+    // names after the resume name that start with prefix
+    auto in_range = [&](const std::string& name) {
+        return name > resume_after && name.compare(0, prefix.size(), prefix) == 0;
+    };
+    const bool ordered = index->Scan(bm, std::max(resume_after, prefix), 
+        [&](const std::string& name, unsigned int) {
+            if(name.compare(0, prefix.size(), prefix) != 0)
+                return false; // past the last name with the prefix
+            if(in_range(name))
+                names.push_back(name);
+            return names.size() < max_entries;
+        });
+    if(!ordered)
+    {
+        ForEachEntry(bm, [&](unsigned int, const Entry& e) {
+            if(in_range(e.name))
+                names.push_back(e.name);
+            return true;
+        });
+        std::sort(names.begin(), names.end());
+        if(names.size() > max_entries)
+            names.resize(max_entries);
+    }
+    EndRead();
+
+    return names;
+}
+
+FSElementPtr Directory::Open(BlockManager& bm, const std::string& filename)
+{
+    FSElementPtr ptr;
+    
+    BeginRead(bm);
+    Entry e;
+    if(isValid && FindEntry(bm, filename, &e) != 0)
+        ptr = LoadEntry(bm, e.block_num, e.type);
+    EndRead();
+
+    return ptr; // returns null if nothing was found
+}
+
+FSElementPtr Directory::Open(BlockManager& bm, const std::string& filename, 
+    unsigned int block_num, ElementType type, unsigned long unlink_stamp)
+{
+    FSElementPtr ptr;
+
+    // the entry can't be removed (and its element freed) while it's loaded
+    BeginRead(bm);
+    Entry e;
+    // the entries of a removed directory are being freed
+    if(isValid)
+    {
+        if(unlink_stamp == this->unlink_stamp)
+            ptr = LoadEntry(bm, block_num, type);
+        else if(FindEntry(bm, filename, &e) != 0)
+            ptr = LoadEntry(bm, e.block_num, e.type);
+    }
+    EndRead();
+
+    return ptr; // returns null if the entry is gone
+}
+
+void Directory::Lookup(BlockManager& bm, const std::string& filename, unsigned int& block_num, ElementType& type, 
+    unsigned long& unlink_stamp) const
+{
+    BeginRead(bm);
+    Entry e;
+    block_num = 0;
+    if(FindEntry(bm, filename, &e) != 0)
+    {
+        block_num = e.block_num;
+        type = e.type;
+    }
+    unlink_stamp = this->unlink_stamp;
+    EndRead();
+}
+
+bool Directory::LookupMetadata(BlockManager& bm, const std::string& filename, unsigned int& block_num, 
+    Inode::Metadata& mtd, unsigned int& generation) const
+{
+    BeginRead(bm);
+    Entry e;
+    const bool found = FindEntry(bm, filename, &e) != 0;
+    if(found)
+    {
+        const Inode entry_inode = Inode::Load(bm, e.block_num);
+        block_num = e.block_num;
+        mtd = entry_inode.GetMetadata();
+        generation = entry_inode.GetGeneration();
+    }
+    EndRead();
+    return found;
+}
+
+bool Directory::Remove(BlockManager& bm, const std::string& filename, unsigned int& block_num, ElementType& type)
+{
+    BeginWrite(bm);
+    Entry e;
+    // the entries of a removed directory are freed along with it
+    const unsigned int offset = isValid ? FindEntry(bm, filename, &e) : 0;
+    if(offset != 0)
+    {
+        EraseEntry(bm, offset, filename);
+        block_num = e.block_num;
+        type = e.type;
+    }
+    EndWrite();
+    return offset != 0;
+}
+
+bool Directory::Move(BlockManager& bm, Directory& src, const std::string& old_name, 
+    Directory& dst, const std::string& new_name)
+{
+    // both parents are locked for the whole move so a lookup never sees the entry in both or neither
+    // they are always locked in block order, so two moves in opposite directions can't deadlock
+    Directory* first = &src;
+    Directory* second = &dst;
+    if(second->inode_block < first->inode_block)
+        std::swap(first, second);
+    first->BeginWrite(bm);
+    if(second != first)
+        second->BeginWrite(bm);
+
+    bool res = false;
+    Entry e;
+    // nothing is moved in or out of a removed directory
+    const unsigned int offset = src.isValid && dst.isValid ? src.FindEntry(bm, old_name, &e) : 0;
+    if(offset != 0 && dst.FindEntry(bm, new_name) == 0)
+    {
+        // only the entry is relinked, the element itself (and its data) stays where it is
+        // the new entry is added first, if there is no room for it nothing has changed yet
+        // (in the same directory the old record is still in use, so it can't be placed over it)
+        res = dst.AppendEntry(bm, e.block_num, e.type, new_name.c_str());
+        if(res)
+            src.EraseEntry(bm, offset, old_name);
+    }
+
+    if(second != first)
+        second->EndWrite();
+    first->EndWrite();
+    return res;
+}
+
+void Directory::EraseEntry(BlockManager& bm, unsigned int offset, const std::string& filename)
+{
+    unlink_stamp = next_unlink_stamp++;
+    index->Erase(bm, filename, offset);
+    RecordHeader rh;
+    inode.Read(bm, offset, &rh, sizeof(RecordHeader));
+    FreeRecordAt(bm, offset, rh.rec_len);
+    hdr.num_entries--;
+    inode.Write(bm, inode_block, 0, &hdr, sizeof(Header));
+}
+
+void Directory::Sync(BlockManager& bm)
+{
+    BeginWrite();
+    // a removed directory may still be opened, its blocks are not its own anymore
+    if(isValid && hdr.free_bytes * CompactionRatio > hdr.end - sizeof(Header))
+        Compact(bm);
+    EndWrite();
+    FSElement::Sync(bm);
+}
+
+void Directory::Compact(BlockManager& bm)
+{
+    std::vector<Entry> entries;
+    entries.reserve(hdr.num_entries);
+    ForEachEntry(bm, [&](unsigned int, const Entry& e) {
+        entries.push_back(e);
+        return true;
+    });
+
+    // write the entries back to back from the start, the index is rebuilt with their new offsets
+    // this invalidates the cookies of listings in progress
+    index->Clear(bm);
+    hdr.generation++;
+    hdr.end = sizeof(Header);
+    hdr.free_head = 0;
+    hdr.free_bytes = 0;
+    // the records only move towards the start, into blocks that are allocated already
+    // so the ones past the new end are only freed once they are all written
+    for(const Entry& e : entries)
+    {
+        unsigned int rec_len;
+        const unsigned int offset = PlaceRecord(bm, RecordSize(e.name), rec_len);
+        WriteRecord(bm, offset, rec_len, e);
+        index->Insert(bm, e.name, offset);
+    }
+    inode.Truncate(bm, inode_block, hdr.end);
+    inode.Write(bm, inode_block, 0, &hdr, sizeof(Header));
+}
+
+void Directory::FreeDatablocks(BlockManager& bm)
+{
+    BeginWrite();
+    index->Free(bm);
+    EndWrite();
+    FSElement::FreeDatablocks(bm);
+}
+
+void Directory::CollectBlocks(BlockManager& bm, std::vector<unsigned int>& block_nums)
+{
+    BeginWrite();
+    index->CollectBlocks(bm, block_nums);
+    EndWrite();
+    FSElement::CollectBlocks(bm, block_nums);
+}
+
+void Directory::ForEachChild(const BlockManager& bm, const std::function<void(unsigned int, ElementType)>& fn) const
+{
+    BeginRead();
+    ForEachEntry(bm, [&](unsigned int, const Entry& e) {
+        fn(e.block_num, e.type);
+        return true;
+    });
+    EndRead();
+}
+
+FSElementPtr Directory::LoadEntry(BlockManager& bm, unsigned int block_num, ElementType type)
+{
+    // load the appropriate type of element based on the element type
+    if(type == ElementType::File)
+        return File::Load(bm, block_num);
+    else if(type == ElementType::Directory)
+        return Directory::Load(bm, block_num);
+    return FSElementPtr();
+}
+
+unsigned int Directory::PlaceRecord(BlockManager& bm, unsigned int size, unsigned int& rec_len)
+{
+    // first fit among the first few free records
+    unsigned int prev = 0;
+    unsigned int cur = hdr.free_head;
+    for(unsigned int n = 0; cur != 0 && n < MaxFreeProbes; n++)
+    {
+        FreeRecord fr;
+        inode.Read(bm, cur, &fr, sizeof(FreeRecord));
+        if(fr.rh.rec_len < size)
+        {
+            prev = cur;
+            cur = fr.next;
+            continue;
+        }
+
+        // unlink it from the free list
+        if(prev == 0)
+            hdr.free_head = fr.next;
+        else
+            inode.Write(bm, inode_block, prev + offsetof(FreeRecord, next), &fr.next, sizeof(unsigned int));
+        hdr.free_bytes -= fr.rh.rec_len;
+        // whatever is left over becomes a free record of its own
+        rec_len = fr.rh.rec_len;
+        if(rec_len - size >= sizeof(FreeRecord))
+        {
+            FreeRecordAt(bm, cur + size, rec_len - size);
+            rec_len = size;
+        }
+        return cur;
+    }
+
+    // append, moving on to the next block if the record doesn't fit in the current one
+    const unsigned int left = Disk::BlockSize - hdr.end % Disk::BlockSize;
+    if(size > left)
+    {
+        FreeRecordAt(bm, hdr.end, left);
+        hdr.end += left;
+    }
+    rec_len = size;
+    const unsigned int offset = hdr.end;
+    hdr.end += size;
+    return offset;
+}
+
+bool Directory::WriteRecord(BlockManager& bm, unsigned int offset, unsigned int rec_len, const Entry& e)
+{
+    char buf[sizeof(RecordHeader) + MaxNameLen];
+    RecordHeader rh = { e.block_num, (unsigned short)rec_len, (unsigned char)e.type, (unsigned char)e.name.size() };
+    memcpy(buf, &rh, sizeof(RecordHeader));
+    memcpy(buf + sizeof(RecordHeader), e.name.data(), e.name.size());
+    const unsigned int size = sizeof(RecordHeader) + e.name.size();
+    return inode.Write(bm, inode_block, offset, buf, size) == size;
+}
+
+void Directory::FreeRecordAt(BlockManager& bm, unsigned int offset, unsigned int rec_len)
+{
+    FreeRecord fr = { { 0, (unsigned short)rec_len, 0, 0 }, hdr.free_head };
+    hdr.free_bytes += rec_len;
+    // space too small to be linked is only marked free
+    if(rec_len < sizeof(FreeRecord))
+    {
+        inode.Write(bm, inode_block, offset, &fr.rh, sizeof(RecordHeader));
+        return;
+    }
+    inode.Write(bm, inode_block, offset, &fr, sizeof(FreeRecord));
+    hdr.free_head = offset;
+}
+
+bool Directory::ReadEntry(const BlockManager& bm, unsigned int offset, Entry& e) const
+{
+    // a record never crosses a block so this reads a single block
+    char buf[sizeof(RecordHeader) + MaxNameLen];
+    const unsigned int size = std::min<unsigned int>(sizeof(buf), Disk::BlockSize - offset % Disk::BlockSize);
+    inode.Read(bm, offset, buf, size);
+    RecordHeader rh;
+    memcpy(&rh, buf, sizeof(RecordHeader));
+    if(rh.block_num == 0)
+        return false;
+    e.block_num = rh.block_num;
+    e.type = (ElementType)rh.type;
+    e.name.assign(buf + sizeof(RecordHeader), rh.name_len);
+    return true;
+}
+
+unsigned int Directory::ForEachEntry(const BlockManager& bm, 
+    const std::function<bool(unsigned int, const Entry&)>& fn, unsigned int from) const
+{
+    char buf[Disk::BlockSize];
+    Entry e;
+    for(unsigned int block_start = from / Disk::BlockSize * Disk::BlockSize; block_start < hdr.end; block_start += Disk::BlockSize)
+    {
+        inode.Read(bm, block_start, buf, Disk::BlockSize);
+        const unsigned int block_end = std::min(Disk::BlockSize, hdr.end - block_start);
+        // from is only inside the first block visited
+        unsigned int pos = std::max(from, block_start) - block_start;
+        while(pos < block_end)
+        {
+            RecordHeader rh;
+            memcpy(&rh, buf + pos, sizeof(RecordHeader));
+            if(rh.rec_len == 0) // should never happen, but it would loop forever
+                break;
+            if(rh.block_num != 0)
+            {
+                e.block_num = rh.block_num;
+                e.type = (ElementType)rh.type;
+                e.name.assign(buf + pos + sizeof(RecordHeader), rh.name_len);
+                if(!fn(block_start + pos, e))
+                    return block_start + pos;
+            }
+            pos += rh.rec_len;
+        }
+    }
+    return hdr.end;
+}
+
+bool Directory::EntryExists(const BlockManager& bm, const std::string& filename)
+{
+    return FindEntry(bm, filename) != 0;
+}
+
+unsigned int Directory::FindEntry(const BlockManager& bm, const std::string& filename, Entry* e) const
+{
+    Entry candidate;
+    // a hash index only narrows it down to entries with the same hash, the name still has to be compared
+    const unsigned int offset = index->Find(bm, filename, [&](unsigned int offset) {
+        return ReadEntry(bm, offset, candidate) && candidate.name == filename;
+    });
+    if(offset != 0 && e)
+        ReadEntry(bm, offset, *e);
+    return offset;
+}
+
+unsigned int Directory::RecordSize(const std::string& name)
+{
+    const unsigned int size = sizeof(RecordHeader) + name.size();
+    return (size + RecordAlign - 1) / RecordAlign * RecordAlign;
+}
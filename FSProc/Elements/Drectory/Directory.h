@@ -1,59 +1,200 @@
-#pragma once
-
-#include <FSElement.h>
-#include <File.h>
-#include <vector>
-
-namespace FS
-{
-	class Directory : public FSElement
-	{
-		struct Entry
-		{
-			int block_num;
-			char name[MaxNameLen + 1];
-		};
-	public:
-        // only move constructor available publicly
-        Directory(Directory&& d) = default;
-        // happens automatically, but just to be explicit about it
-        Directory(const Directory& rhs) = delete;
-        Directory& operator=(const Directory& rhs) = delete;
-        // create a root directory
-        static DirPtr CreateRoot(BlockManager& bm, int root_uid = 0, int rootdir_permissions = 0x6);
-        // load a root directory if one exists
-        static DirPtr LoadRoot(BlockManager& bm);
-        // add a new FSElement into the directory's entry list
-        bool Add(BlockManager& bm, const char* name, ElementType t, int owner, int permissions);
-        // get rhe number of entries
-		unsigned int GetNumEntries() const;
-        // ge ta list of the entries in the directory with their metadata
-		std::vector<std::string> List(BlockManager& bm) const;
-        // open a FSElement in the drectroy
-        FSElementPtr Open(BlockManager& bm, const std::string& filename);
-        // 
-        void Remove(BlockManager& bm, const std::string& filename);
-
-        // check if an entry with the name exists
-        bool EntryExists(const BlockManager& bm, const std::string& filename);
-	private:
-        /* kept hidden so only root can be loaded directly, all other directories must be loaded from root */
-
-        // load a directory from the inode blokc
-        Directory(BlockManager& bm, unsigned int inode_block);
-        // create a directory with the inode at the given block
-		Directory(BlockManager& bm, int owner, int permissions);
-        // load an inode from the inode block
-        static DirPtr Load(BlockManager& bm, unsigned int inode_block);
-
-        // get the entry structure at the given index
-		Entry GetEntry(const BlockManager& bm, unsigned int idx) const;
-        // get the index of the entry with the given name
-        int GetEntryIdx(const BlockManager& bm, const std::string& filename) const;
-
-	private:
-		int num_entries = 0;
-	};
-}
-
-
+#pragma once
+
+#include <FSElement.h>
+#include <File.h>
+#include <DirIndex.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace FS
+{
+	class Directory : public FSElement
+	{
+        // an entry read into memory
+		struct Entry
+		{
+			unsigned int block_num;
+			ElementType type;
+			std::string name;
+		};
+        // start of every record on disk, an entry's record is followed by its name (not null terminated)
+        // records are packed densely but never cross a block, rec_len is the distance to the next one
+        struct RecordHeader
+        {
+            unsigned int block_num; // 0 for a free record
+            unsigned short rec_len;
+            unsigned char type;
+            unsigned char name_len;
+        };
+        // a free record big enough to be reused, linked to the next one
+        // free space too small for this is only reclaimed by compaction
+        struct FreeRecord
+        {
+            RecordHeader rh;
+            unsigned int next;
+        };
+        // stored at the start of the directory's data, followed by the records
+        struct Header
+        {
+            int num_entries;
+            // inode block of the index used to find entries by name
+            unsigned int index_block;
+            DirFormat format;
+            // offset the next record is appended at
+            unsigned int end;
+            // offset of the first free record (0 if there is none)
+            unsigned int free_head;
+            // bytes in free records
+            unsigned int free_bytes;
+            // bumped whenever the records are moved around
+            unsigned int generation;
+            unsigned int unused;
+        };
+        // records are aligned to this, so there is always room for a header at the end of a block
+        static constexpr unsigned int RecordAlign = sizeof(RecordHeader);
+        static_assert(sizeof(Header) % RecordAlign == 0, "the first record must be aligned");
+        // number of free records checked for space before appending instead
+        static constexpr unsigned int MaxFreeProbes = 8;
+        // the records are compacted once more than 1/CompactionRatio of their space is free
+        static constexpr unsigned int CompactionRatio = 4;
+	public:
+        // an element to create with AddMany
+        struct NewEntry
+        {
+            std::string name;
+            ElementType type;
+            int permissions;
+        };
+        // an entry along with the metadata of its element
+        struct EntryInfo
+        {
+            std::string name;
+            // as stored in the inode, an opened element may hold newer metadata
+            Inode::Metadata metadata;
+            unsigned int block_num;
+        };
+        // only move constructor available publicly
+        Directory(Directory&& d) = default;
+        // happens automatically, but just to be explicit about it
+        Directory(const Directory& rhs) = delete;
+        Directory& operator=(const Directory& rhs) = delete;
+        // create a root directory
+        static DirPtr CreateRoot(BlockManager& bm, int root_uid = 0, int rootdir_permissions = 0x6);
+        // load a root directory if one exists
+        static DirPtr LoadRoot(BlockManager& bm);
+        // add a new FSElement into the directory's entry list
+        // this and the other changes to the entries fail once the directory was removed
+        bool Add(BlockManager& bm, const char* name, ElementType t, int owner, int permissions);
+        // add a batch of new elements at once, their inodes are allocated together and the directory is saved once
+        // returns whether each entry was added (it isn't if the name exists or there is no room left)
+        std::vector<bool> AddMany(BlockManager& bm, const std::vector<NewEntry>& entries, int owner);
+        // add a new file that shares all of src's data blocks (copy on write)
+        bool Clone(BlockManager& bm, const char* name, const File& src, int owner);
+        // get rhe number of entries
+		unsigned int GetNumEntries() const;
+        // ge ta list of the entries in the directory with their metadata
+		std::vector<std::string> List(BlockManager& bm) const;
+        // list every entry with its element's metadata (readdir-plus)
+        // the elements are not loaded, their inodes are read in batches in block order
+        std::vector<EntryInfo> ListPlus(BlockManager& bm) const;
+        // list the entries a page at a time, in the order they are stored
+        // cookie is 0 for the first page, after that the value returned by the previous call
+        // fits is asked about every entry before it is added to the page and ends the page once it returns false
+        // returns the cookie for the next page (the page is empty once the end is reached)
+        // or -2 if the cookie is stale because the directory was compacted since
+        long long ListPage(BlockManager& bm, long long cookie, 
+            const std::function<bool(const std::string&)>& fits, std::vector<EntryInfo>& page) const;
+        // get up to max_entries names sorted by name, starting after the resume name ("" starts at the beginning)
+        // only names starting with prefix are listed
+        // B+tree directories only read the leaves holding the listed names, others have to sort all of them
+        std::vector<std::string> List(BlockManager& bm, const std::string& resume_after, 
+            unsigned int max_entries, const std::string& prefix = "") const;
+        // open a FSElement in the drectroy
+        FSElementPtr Open(BlockManager& bm, const std::string& filename);
+        // open a FSElement from what Lookup found for it earlier, under the read lock
+        // the entry is only looked up again if something was taken out of the directory since then
+        FSElementPtr Open(BlockManager& bm, const std::string& filename, 
+            unsigned int block_num, ElementType type, unsigned long unlink_stamp);
+        // find the inode block and type of an entry without loading it
+        // block_num is set to 0 if there is no such entry
+        // unlink_stamp is set to what Open has to be given to trust the entry without looking it up again
+        void Lookup(BlockManager& bm, const std::string& filename, unsigned int& block_num, ElementType& type, 
+            unsigned long& unlink_stamp) const;
+        // find an entry and read its metadata and generation from its inode before it can be removed
+        // (and the block reused), returns false if there is no such entry
+        bool LookupMetadata(BlockManager& bm, const std::string& filename, unsigned int& block_num, 
+            Inode::Metadata& mtd, unsigned int& generation) const;
+        // only the removed entry's block and the header are written, its space is reused by later entries
+        // block_num and type are set to the element of the entry that was removed under the write lock
+        // returns false if there was no such entry
+        bool Remove(BlockManager& bm, const std::string& filename, unsigned int& block_num, ElementType& type);
+        // move the entry old_name in src to new_name in dst (which may be src), the element is not copied
+        // fails if there is no old_name, if new_name already exists or if dst has no room for it
+        static bool Move(BlockManager& bm, Directory& src, const std::string& old_name, 
+            Directory& dst, const std::string& new_name);
+        // compacts the entries if too many slots are free
+        void Sync(BlockManager& bm) override;
+        // frees the name index along with the entries
+        void FreeDatablocks(BlockManager& bm) override;
+        // the name index's blocks are collected along with the entries
+        void CollectBlocks(BlockManager& bm, std::vector<unsigned int>& block_nums) override;
+        // call fn with the inode block and type of every entry's element
+        void ForEachChild(const BlockManager& bm, const std::function<void(unsigned int, ElementType)>& fn) const;
+        // load the element at the block as the given type
+        static FSElementPtr LoadEntry(BlockManager& bm, unsigned int block_num, ElementType type);
+
+        // check if an entry with the name exists
+        bool EntryExists(const BlockManager& bm, const std::string& filename);
+	private:
+        /* kept hidden so only root can be loaded directly, all other directories must be loaded from root */
+
+        // load a directory from the inode blokc
+        Directory(BlockManager& bm, unsigned int inode_block);
+        // create a directory, its inode goes in block_num if it was allocated already
+		Directory(BlockManager& bm, int owner, int permissions, unsigned int block_num = 0);
+        // load an inode from the inode block
+        static DirPtr Load(BlockManager& bm, unsigned int inode_block);
+
+        // add an entry for the element at block_num, must be called in write mode
+        // returns false if the index is full
+        bool AppendEntry(BlockManager& bm, unsigned int block_num, ElementType type, const char* name);
+        // same as AppendEntry, but the header is only changed in memory
+        // returns the offset of the entry's record or 0 if there was no room for it (nothing is changed then)
+        unsigned int InsertEntry(BlockManager& bm, unsigned int block_num, ElementType type, const char* name);
+        // remove the entry whose record is at offset, must be called in write mode
+        void EraseEntry(BlockManager& bm, unsigned int offset, const std::string& filename);
+        // rewrite the entries without the free space between them, must be called in write mode
+        void Compact(BlockManager& bm);
+        // find room for a record of the given size, reusing free space if possible
+        // returns its offset, rec_len is set to the space it actually takes
+        unsigned int PlaceRecord(BlockManager& bm, unsigned int size, unsigned int& rec_len);
+        // write an entry's record, returns false if its block couldn't be allocated
+        bool WriteRecord(BlockManager& bm, unsigned int offset, unsigned int rec_len, const Entry& e);
+        // turn the space at offset into a free record
+        void FreeRecordAt(BlockManager& bm, unsigned int offset, unsigned int rec_len);
+        // read the entry whose record is at offset, returns false if the record is free
+        bool ReadEntry(const BlockManager& bm, unsigned int offset, Entry& e) const;
+        // call fn with every entry from the record at from onwards (and the offset of its record) until it returns false
+        // the records are read a block at a time
+        // returns the offset of the record fn stopped at, or the end of the records
+        unsigned int ForEachEntry(const BlockManager& bm, 
+            const std::function<bool(unsigned int, const Entry&)>& fn, unsigned int from = sizeof(Header)) const;
+        // find the entry with the given name using the index
+        // returns the offset of its record (0 if it doesn't exist)
+        unsigned int FindEntry(const BlockManager& bm, const std::string& filename, Entry* e = nullptr) const;
+        // space a record for the name takes up
+        static unsigned int RecordSize(const std::string& name);
+
+	private:
+		Header hdr = {};
+		std::unique_ptr<DirIndex> index;
+        // changed whenever an entry is taken out, under the write lock
+        // the values come from a counter shared by all directories, so a directory that is loaded again
+        // (or a new one in the same block) never has a value handed out for an earlier one
+        unsigned long unlink_stamp = next_unlink_stamp++;
+        static inline std::atomic<unsigned long> next_unlink_stamp{ 1 };
+	};
+}
+
+
@@ -11,6 +11,8 @@ namespace FS
 		Directory,
 		File,
 		SymLink,
+        // holds a directory's name index, never appears as an entry
+		Index,
 	};
 
     using FSElementPtr = std::unique_ptr<class FSElement>;
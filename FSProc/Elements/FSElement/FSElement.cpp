@@ -12,26 +12,46 @@ FSElement::FSElement(BlockManager& bm, unsigned int inode_block)
     inode_block(inode_block)
 {
     // load an existing inode
+    // loading is not an access by itself, the access time is updated by the reads that follow
     inode = Inode::Load(bm, inode_block);
-    inode.UpdateTimeAccessed(bm, inode_block);
+    Publish();
 }
 
-FSElement::FSElement(BlockManager& bm, ElementType type, int owner, int permissions)
+FSElement::FSElement(BlockManager& bm, ElementType type, int owner, int permissions, unsigned int block_num)
+    :
+    inode_block(block_num)
 {
     // create a new inode
-    inode_block = bm.AlloateFreeBlock();
+    if(inode_block == 0)
+        inode_block = bm.AlloateFreeBlock();
     inode = Inode::Create(bm, inode_block, type, owner, permissions);
+    Publish();
+}
+
+FSElement::FSElement(BlockManager& bm, const FSElement& src, int owner)
+{
+    // src can't be written to while its blocks are being shared
+    // this includes in-place writes, which only hold the lock in read mode
+    src.BeginWrite();
+    // a removed src's blocks are being freed, there is nothing left to share
+    inode_block = src.isValid ? bm.AlloateFreeBlock() : 0;
+    if(inode_block != 0 && !Inode::Clone(bm, src.inode, inode_block, owner, inode))
+    {
+        bm.FreeBlock(inode_block);
+        inode_block = 0;
+    }
+    src.EndWrite();
+    Publish();
 }
 
 FSElement::FSElement(FSElement&& rhs) noexcept
 {
-    // locking the mutexes ensures the object is not moved during a read/write operation
+    // locking rhs ensures the object is not moved during a read/write operation
     // although this is unlikely to happen as the only time a move occurs is during construction
-    std::unique_lock<std::mutex> lock1(rw_mtx);
-    std::unique_lock<std::mutex> lock2(mtx);
-    reader_count = rhs.reader_count;
+    std::unique_lock<RWLock> lock(rhs.rw_lock);
     inode = std::move(rhs.inode);
     inode_block = rhs.inode_block;
+    Publish();
 }
 
 void FSElement::FreeDatablocks(BlockManager& bm)
@@ -50,91 +70,154 @@ void FSElement::FreeInodeBlock(BlockManager& bm)
     EndWrite();
 }
 
+void FSElement::CollectBlocks(BlockManager& bm, std::vector<unsigned int>& block_nums)
+{
+    BeginWrite();
+    inode.CollectBlocks(bm, block_nums);
+    block_nums.push_back(inode_block);
+    isValid = false;
+    EndWrite();
+}
+
+void FSElement::Detach(BlockManager&)
+{
+    BeginWrite();
+    isValid = false;
+    EndWrite();
+}
+
+void FSElement::Sync(BlockManager& bm)
+{
+    // hold off writers so the inode is not saved halfway through a modification
+    BeginRead();
+    mtx.lock(); // readers update the access time under mtx
+    if(isValid)
+        inode.SyncTimes(bm, inode_block);
+    mtx.unlock();
+    EndRead();
+}
+
 ElementType FSElement::GetType() const
 {
-    return inode.GetType();
+    return snapshot.Load().mtd.type;
 }
 
 Inode::Metadata FSElement::GetMetadata() const
 {
-    return inode.mtd;
+    return snapshot.Load().mtd;
 }
 
 unsigned int FSElement::FSElement::GetSize() const
 {
-    return inode.mtd.size;
+    return snapshot.Load().mtd.size;
 }
 
 unsigned int FSElement::GetSizeOnDisk() const
 {
-    return inode.mtd.size * Disk::BlockSize + Disk::BlockSize;
+    return snapshot.Load().size_on_disk;
 }
 
 int FSElement::GetOwner() const
 {
-    return inode.mtd.owner;
+    return snapshot.Load().mtd.owner;
 }
 
 int FSElement::GetPermissions() const
 {
-    return inode.mtd.permissions;
+    return snapshot.Load().mtd.permissions;
 }
 
 int FSElement::GetTimeCreated() const
 {
-    return inode.mtd.created;
+    return snapshot.Load().mtd.created;
 }
 
 int FSElement::GetTimeModified() const
 {
-    return inode.mtd.modified;
+    return snapshot.Load().mtd.modified;
 }
 
 int FSElement::GetTimeAccessed() const
 {
-    return inode.mtd.accessed;
+    return snapshot.Load().mtd.accessed;
+}
+
+unsigned int FSElement::GetInodeBlock() const
+{
+    return inode_block;
+}
+
+unsigned int FSElement::GetGeneration(BlockManager& bm)
+{
+    BeginRead();
+    unsigned int generation = inode.generation;
+    EndRead();
+    if(generation != 0)
+        return generation;
+
+    BeginWrite();
+    if(inode.generation == 0 && isValid)
+    {
+        inode.generation = bm.NextGeneration();
+        inode.Save(bm, inode_block);
+    }
+    generation = inode.generation;
+    EndWrite();
+    return generation;
+}
+
+bool FSElement::IsRemoved() const
+{
+    return !isValid;
 }
 
 void FSElement::BeginRead(BlockManager& bm) const
 {
-    mtx.lock(); // lock mtx before accessing reader count and access time
-    if(reader_count == 0) // lock rw_mtx id this is the first reader
-        rw_mtx.lock();
-    reader_count++;
+    rw_lock.lock_shared();
+    mtx.lock(); // other readers may be updating the access time as well
     inode.UpdateTimeAccessed(bm, inode_block);
+    Publish();
     mtx.unlock();
 }
 
 void FSElement::BeginRead() const
 {
-    mtx.lock(); // lock mtx before accessing reader count
-    if(reader_count == 0) // lock rw_mtx id this is the first reader
-        rw_mtx.lock();
-    reader_count++;
-    mtx.unlock();
+    rw_lock.lock_shared();
 }
 
 void FSElement::EndRead() const
 {
-    mtx.lock(); // lock mtx before accessing reader count and access time
-    reader_count--;
-    if(reader_count == 0) // unlock rw_mtx id this is the last reader
-        rw_mtx.unlock();
-    mtx.unlock();
+    rw_lock.unlock_shared();
 }
 
 void FSElement::BeginWrite(BlockManager& bm) const
 {
-    rw_mtx.lock(); // just need to lock the rw_mtx
+    rw_lock.lock();
     inode.UpdateTimeModified(bm, inode_block);
 }
 
 void FSElement::BeginWrite() const
 {
-    rw_mtx.lock(); // just need to lock the rw_mtx
+    rw_lock.lock();
+}
+
+void FSElement::UpdateTimeModified(BlockManager& bm) const
+{
+    mtx.lock(); // other readers may be updating the times as well
+    inode.UpdateTimeModified(bm, inode_block);
+    Publish();
+    mtx.unlock();
 }
 
 void FSElement::EndWrite() const
 {
-    rw_mtx.unlock(); // unlock the rw_mtx to allow the next writer or first reader to enter
+    // nobody else can be publishing while the lock is held in write mode
+    Publish();
+    rw_lock.unlock(); // lets the next writer or the waiting readers in
+}
+
+void FSElement::Publish() const
+{
+    // the size on disk counts the inode block itself as well
+    snapshot.Store({ inode.mtd, inode.GetSizeOnDisk() + Disk::BlockSize });
 }
\ No newline at end of file
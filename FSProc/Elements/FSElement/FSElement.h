@@ -1,71 +1,106 @@
-#pragma once
-
-#include <BlockManager.h>
-#include <Inode.h>
-#include <mutex>
-
-namespace FS
-{
-	class FSElement
-	{
-    public:
-        /* Public interface to all the inode getters as the inode itself is hidden */
-
-        Inode::Metadata GetMetadata() const;
-        ElementType GetType() const;
-        unsigned int GetSize() const;
-        unsigned int GetSizeOnDisk() const;
-        int GetOwner() const;
-        int GetPermissions() const;
-        int GetTimeCreated() const;
-        int GetTimeModified() const;
-        int GetTimeAccessed() const;
-
-        void FreeDatablocks(BlockManager& bm);
-        void FreeInodeBlock(BlockManager& bm);
-
-        // good idea to make virtual destructors for classes meant to be inherited
-        virtual ~FSElement() = default;
-	protected:
-        /* Pritected constructors so only derived classes can make an FSElement */
-        // basically turns this into an abstract class without using virtual
-
-        // default ctor so derived classes can make default ctors
-		FSElement();
-        // load the FSElement using the given inode
-		FSElement(BlockManager& bm, unsigned int inode_block);
-        // create a new FSElement
-		FSElement(BlockManager& bm, ElementType type, int owner, int permissions);
-        // move ctor to make the derived types movable
-        // needed due to the mutexes being used in this class
-        FSElement(FSElement&& rhs) noexcept;
-        // explicitly deleting these two for the sake of thread safety
-        // copies of FSElements can lead to... not fun situations
-        FSElement(const FSElement&) = delete;
-        FSElement& operator=(const FSElement&) = delete;
-
-        /* Reader-Writer Thread safety mechanisms */
-
-        void BeginRead(BlockManager& bm) const;
-        void BeginRead() const;
-        void EndRead() const;
-        void BeginWrite(BlockManager& bm) const;
-        void BeginWrite() const;
-        void EndWrite() const;
-
-	protected:
-        // inodes are modified even during read operations
-        // it felt right to make them mutable
-		mutable Inode inode;
-        // the block where the inode is stored
-		unsigned int inode_block;
-        //
-        bool isValid = true;
-    private:
-        /* reader-writer problem stuff */
-
-        mutable int reader_count = 0;
-		mutable std::mutex rw_mtx;
-		mutable std::mutex mtx;
-	};
-}
+#pragma once
+
+#include <BlockManager.h>
+#include <Inode.h>
+#include <RWLock.h>
+#include <SeqLock.h>
+#include <atomic>
+#include <mutex>
+
+namespace FS
+{
+	class FSElement
+	{
+        // what the getters return, kept apart from the inode so they don't have to wait for writers
+        struct MetadataSnapshot
+        {
+            Inode::Metadata mtd;
+            unsigned int size_on_disk;
+        };
+    public:
+        /* Public interface to all the inode getters as the inode itself is hidden */
+        /* they read the metadata as of the last finished change, without locking */
+
+        Inode::Metadata GetMetadata() const;
+        ElementType GetType() const;
+        unsigned int GetSize() const;
+        unsigned int GetSizeOnDisk() const;
+        int GetOwner() const;
+        int GetPermissions() const;
+        int GetTimeCreated() const;
+        int GetTimeModified() const;
+        int GetTimeAccessed() const;
+        unsigned int GetInodeBlock() const;
+        // the inode's generation, inodes from before generations were kept are given one now
+        unsigned int GetGeneration(BlockManager& bm);
+        // the element was removed while it was opened, anything that would change it fails from then on
+        bool IsRemoved() const;
+
+        virtual void FreeDatablocks(BlockManager& bm);
+        void FreeInodeBlock(BlockManager& bm);
+        // append every block the element owns (including its inode block) to block_nums
+        // so a whole removed tree can be freed in batches, the element is invalid afterwards
+        virtual void CollectBlocks(BlockManager& bm, std::vector<unsigned int>& block_nums);
+        // the element was removed while it is still opened
+        // nothing it holds in memory is written back after this, its blocks are freed by whoever removed it
+        virtual void Detach(BlockManager& bm);
+        // write back any inode changes that are only kept in memory (lazytime)
+        virtual void Sync(BlockManager& bm);
+
+        // good idea to make virtual destructors for classes meant to be inherited
+        virtual ~FSElement() = default;
+	protected:
+        /* Pritected constructors so only derived classes can make an FSElement */
+        // basically turns this into an abstract class without using virtual
+
+        // default ctor so derived classes can make default ctors
+		FSElement();
+        // load the FSElement using the given inode
+		FSElement(BlockManager& bm, unsigned int inode_block);
+        // create a new FSElement
+        // its inode goes in the given block if it was allocated already, otherwise a free one is allocated
+		FSElement(BlockManager& bm, ElementType type, int owner, int permissions, unsigned int block_num = 0);
+        // create a new FSElement that shares all of src's data blocks
+        // inode_block is left 0 if there was no space for it
+		FSElement(BlockManager& bm, const FSElement& src, int owner);
+        // move ctor to make the derived types movable
+        // needed due to the mutexes being used in this class
+        FSElement(FSElement&& rhs) noexcept;
+        // explicitly deleting these two for the sake of thread safety
+        // copies of FSElements can lead to... not fun situations
+        FSElement(const FSElement&) = delete;
+        FSElement& operator=(const FSElement&) = delete;
+
+        /* Reader-Writer Thread safety mechanisms */
+
+        void BeginRead(BlockManager& bm) const;
+        void BeginRead() const;
+        void EndRead() const;
+        void BeginWrite(BlockManager& bm) const;
+        void BeginWrite() const;
+        void EndWrite() const;
+        // update the modified time while only holding the lock in read mode (writes that leave the inode as it is)
+        void UpdateTimeModified(BlockManager& bm) const;
+        // make the inode's current metadata visible to the getters
+        // done by EndWrite and the time updates, anything else changing the inode must call it itself
+        void Publish() const;
+
+	protected:
+        // inodes are modified even during read operations
+        // it felt right to make them mutable
+		mutable Inode inode;
+        // the block where the inode is stored
+		unsigned int inode_block;
+        // cleared once the element is removed, its blocks may belong to others after that
+        // changes check it under the write (or range) lock, as Detach clears it under the write lock
+        std::atomic<bool> isValid{ true };
+        // readers share rw_lock, what they change in the inode (the times, the end of an appended file) 
+        // is guarded by this
+		mutable std::mutex mtx;
+    private:
+        /* reader-writer problem stuff */
+
+		mutable RWLock rw_lock;
+		mutable SeqLock<MetadataSnapshot> snapshot;
+	};
+}
@@ -1,34 +1,303 @@
-#include <File.h>
-#include <unistd.h>
-
-using namespace FS;
-
-File::File(BlockManager& bm, unsigned int inode_block)
-    :
-    FSElement(bm, inode_block)
-{
-    inode.UpdateTimeAccessed(bm, inode_block);
-}
-
-File::File(BlockManager& bm, int owner, int permissions)
-    :
-    FSElement(bm, ElementType::File, owner, permissions)
-{}
-
-int File::Read(BlockManager& bm, char* data, int offset, int size) const
-{
-    BeginRead(bm);
-    int num = inode.Read(bm, offset, data, size);
-    EndRead();
-
-    return num;
-}
-
-int File::Write(BlockManager& bm, const char* data, int offset, int size)
-{
-    BeginWrite(bm);
-    int num = inode.Write(bm, inode_block, offset, data, size);
-    EndWrite();
-    
-    return num;
-}
+#include <File.h>
+#include <unistd.h>
+
+using namespace FS;
+
+// the blocks [offset, offset + size) falls in, as a byte range
+// writes read and write whole blocks, so ranges in the same block have to exclude each other
+static std::pair<unsigned int, unsigned int> BlockRange(int offset, int size)
+{
+    const unsigned int begin = offset / Disk::BlockSize * Disk::BlockSize;
+    const unsigned int end = ((unsigned int)offset + size + Disk::BlockSize - 1) / Disk::BlockSize * Disk::BlockSize;
+    return { begin, end };
+}
+
+File::File(BlockManager& bm, unsigned int inode_block)
+    :
+    FSElement(bm, inode_block)
+{}
+
+File::File(BlockManager& bm, int owner, int permissions, unsigned int block_num)
+    :
+    FSElement(bm, ElementType::File, owner, permissions, block_num)
+{}
+
+File::File(BlockManager& bm, const File& src, int owner)
+    :
+    FSElement(bm, src, owner)
+{}
+
+File::File(File&& rhs) noexcept
+    :
+    FSElement(std::move(rhs)),
+    pending(std::move(rhs.pending))
+{}
+
+int File::Read(BlockManager& bm, char* data, int offset, int size) const
+{
+    BeginRead(bm);
+    // appends may be growing the file meanwhile, so this goes by the inode as it is now
+    // (taken before the range, appends hold mtx while they wait for theirs)
+    const Inode current = CurrentInode();
+    const auto range = BlockRange(offset, size);
+    range_lock.Lock(range.first, range.second, false);
+    int num = current.Read(bm, offset, data, size, &pending);
+    range_lock.Unlock(range.first, range.second, false);
+    EndRead();
+
+    return num;
+}
+
+int File::Write(BlockManager& bm, const char* data, int offset, int size)
+{
+    // data that is only overwritten doesn't change the inode, 
+    // so the write only has to keep others out of the blocks it writes
+    BeginRead();
+    // a removed file's blocks are freed and may be reused, nothing is written to them
+    if(!isValid)
+    {
+        EndRead();
+        return -1;
+    }
+    // appends may be growing the file meanwhile, so this goes by the inode as it is now
+    // an overwrite doesn't change the inode, so the copy is never saved
+    Inode current = CurrentInode();
+    if(!bm.GetMountOptions().delalloc && current.IsOverwrite(bm, offset, size))
+    {
+        UpdateTimeModified(bm);
+        const auto range = BlockRange(offset, size);
+        range_lock.Lock(range.first, range.second, true);
+        int num = current.Write(bm, inode_block, offset, data, size);
+        range_lock.Unlock(range.first, range.second, true);
+        EndRead();
+        return num;
+    }
+    EndRead();
+
+    BeginWrite(bm);
+    // it may have been removed while the lock was let go
+    if(!isValid)
+    {
+        EndWrite();
+        return -1;
+    }
+    int num;
+    if(bm.GetMountOptions().delalloc)
+    {
+        // blocks are only chosen once the data is flushed
+        num = inode.WriteDelayed(bm, inode_block, offset, data, size, pending);
+        if(pending.size() >= MaxPendingBlocks)
+            inode.FlushPending(bm, inode_block, pending);
+    }
+    else
+    {
+        num = inode.Write(bm, inode_block, offset, data, size);
+    }
+    EndWrite();
+    
+    return num;
+}
+
+int File::Append(BlockManager& bm, const char* data, int size)
+{
+    if(size < 0)
+        return -1;
+
+    // appenders only hold the lock in read mode, the end of the file is moved under mtx
+    // so each of them reserves a range of its own and they fill their ranges in parallel
+    BeginRead();
+    mtx.lock();
+    const unsigned int offset = inode.GetSize();
+    if(!isValid || (unsigned int)size > Inode::MaxSize - offset)
+    {
+        mtx.unlock();
+        EndRead();
+        return -1;
+    }
+    if(size == 0)
+    {
+        mtx.unlock();
+        EndRead();
+        return offset;
+    }
+    // delayed data goes into the pending blocks and a last block shared with a clone has to be copied
+    // before it's written to, both change more of the inode than the end so they take the lock in write mode
+    const unsigned int tail_block = offset % Disk::BlockSize != 0 ? 
+        inode.GetBlockNum(bm, offset / Disk::BlockSize) : 0;
+    if(bm.GetMountOptions().delalloc || (tail_block != 0 && bm.BlockIsShared(tail_block)))
+    {
+        mtx.unlock();
+        EndRead();
+        return AppendExclusive(bm, data, size);
+    }
+
+    // readers are kept out of the range before the size covers it, its blocks aren't filled in yet
+    // nobody waits for mtx while holding a range, so this can't deadlock
+    const auto range = BlockRange(offset, size);
+    range_lock.Lock(range.first, range.second, true);
+    inode.UpdateTimeModified(bm, inode_block);
+    // the copy is a plain overwrite once the blocks are allocated, so they aren't zeroed first
+    const bool reserved = inode.Preallocate(bm, inode_block, offset, size, false);
+    Publish();
+    // the next append grows the inode while this one copies, the copy goes by the inode as it is now
+    // the range is allocated and covered by the size already, so the copy doesn't change the inode
+    Inode current = inode;
+    mtx.unlock();
+
+    const unsigned int num = reserved ? current.Write(bm, inode_block, offset, data, size) : 0;
+    range_lock.Unlock(range.first, range.second, true);
+    EndRead();
+    if(!reserved)
+        return -1;
+    if(num != (unsigned int)size)
+    {
+        AbortAppend(bm, offset, size);
+        return -1;
+    }
+    return offset;
+}
+
+int File::AppendExclusive(BlockManager& bm, const char* data, int size)
+{
+    BeginWrite(bm);
+    const unsigned int offset = inode.GetSize();
+    if(!isValid || (unsigned int)size > Inode::MaxSize - offset)
+    {
+        EndWrite();
+        return -1;
+    }
+
+    unsigned int num;
+    if(bm.GetMountOptions().delalloc)
+    {
+        num = inode.WriteDelayed(bm, inode_block, offset, data, size, pending);
+        if(pending.size() >= MaxPendingBlocks)
+            inode.FlushPending(bm, inode_block, pending);
+    }
+    else
+    {
+        num = inode.Write(bm, inode_block, offset, data, size);
+    }
+    if(num != (unsigned int)size)
+    {
+        // nobody else saw the part that was written, the file is cut back to where it was
+        // the pending blocks have their space reserved, so flushing them first can't fail
+        inode.FlushPending(bm, inode_block, pending);
+        inode.Truncate(bm, inode_block, offset);
+        EndWrite();
+        return -1;
+    }
+    EndWrite();
+
+    return offset;
+}
+
+void File::AbortAppend(BlockManager& bm, unsigned int offset, int size)
+{
+    BeginWrite();
+    // a file removed in the meantime has nothing left to undo
+    if(!isValid)
+    {
+        EndWrite();
+        return;
+    }
+    if(inode.GetSize() == offset + size)
+    {
+        inode.Truncate(bm, inode_block, offset);
+    }
+    else
+    {
+        // later appends have been placed after it, the range can only be cleared
+        const std::vector<char> zeros(size, 0);
+        inode.Write(bm, inode_block, offset, zeros.data(), size);
+    }
+    EndWrite();
+}
+
+int File::SeekData(const BlockManager& bm, int offset) const
+{
+    BeginRead();
+    int res = CurrentInode().SeekData(bm, offset, &pending);
+    EndRead();
+
+    return res;
+}
+
+int File::SeekHole(const BlockManager& bm, int offset) const
+{
+    BeginRead();
+    int res = CurrentInode().SeekHole(bm, offset, &pending);
+    EndRead();
+
+    return res;
+}
+
+bool File::Truncate(BlockManager& bm, int size)
+{
+    BeginWrite(bm);
+    if(!isValid)
+    {
+        EndWrite();
+        return false;
+    }
+    inode.FlushPending(bm, inode_block, pending);
+    bool res = inode.Truncate(bm, inode_block, size);
+    EndWrite();
+
+    return res;
+}
+
+bool File::Preallocate(BlockManager& bm, int offset, int size)
+{
+    BeginWrite(bm);
+    if(!isValid)
+    {
+        EndWrite();
+        return false;
+    }
+    inode.FlushPending(bm, inode_block, pending);
+    bool res = inode.Preallocate(bm, inode_block, offset, size);
+    EndWrite();
+
+    return res;
+}
+
+void File::CollectBlocks(BlockManager& bm, std::vector<unsigned int>& block_nums)
+{
+    BeginWrite();
+    inode.DiscardPending(bm, pending);
+    EndWrite();
+    FSElement::CollectBlocks(bm, block_nums);
+}
+
+void File::Detach(BlockManager& bm)
+{
+    BeginWrite();
+    inode.DiscardPending(bm, pending);
+    EndWrite();
+    FSElement::Detach(bm);
+}
+
+void File::Sync(BlockManager& bm)
+{
+    BeginWrite();
+    // a removed file may still be opened, nothing is allocated for it anymore
+    if(isValid)
+        inode.FlushPending(bm, inode_block, pending);
+    EndWrite();
+    FSElement::Sync(bm);
+}
+
+Inode File::CurrentInode() const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return inode;
+}
+
+void File::FreeDatablocks(BlockManager& bm)
+{
+    BeginWrite();
+    inode.DiscardPending(bm, pending);
+    EndWrite();
+    FSElement::FreeDatablocks(bm);
+}
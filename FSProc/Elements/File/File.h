@@ -1,32 +1,76 @@
-#pragma once
-
-#include "FSElement.h"
-#include <mutex>
-#include <memory>
-
-namespace FS
-{
-	class File : public FSElement
-	{
-		friend class Directory;
-	public:
-        // reads the given data to the file
-        // returns the number of bytes read
-		int Read(BlockManager& bm, char* data, int offset, int size) const;
-		// writes the given data to the file
-        // returns the number of bytes written
-        int Write(BlockManager& bm, const char* data, int offset, int size);
-
-	private: // only Directory can make a new file
-		File(BlockManager& bm, unsigned int inode_block);
-		File(BlockManager& bm, int owner, int permissions);
-
-        // just for QoL
-        static FilePtr Load(BlockManager& bm, int inode_block)
-        {
-            return std::make_unique<File>(File(bm, inode_block));
-        }
-	};
-}
-
-
+#pragma once
+
+#include "FSElement.h"
+#include <RangeLock.h>
+#include <mutex>
+#include <memory>
+
+namespace FS
+{
+	class File : public FSElement
+	{
+		friend class Directory;
+        // delayed writes are flushed once this many blocks are held in memory
+		static constexpr unsigned int MaxPendingBlocks = 32;
+	public:
+        // the range lock can't be moved, the new file gets a fresh one
+        File(File&& rhs) noexcept;
+        // reads the given data to the file
+        // returns the number of bytes read
+		int Read(BlockManager& bm, char* data, int offset, int size) const;
+		// writes the given data to the file
+        // overwriting existing data runs alongside reads and writes of other blocks,
+        // anything that allocates or changes the size has the whole file to itself
+        // returns the number of bytes written or -1 if the file was removed
+        int Write(BlockManager& bm, const char* data, int offset, int size);
+        // write all of data at the end of the file, concurrent appends each get a range of their own
+        // only reserving the range is serialized, the data is copied in alongside other appends
+        // returns the offset the data was written at or -1 if it doesn't fit or the file was removed
+        // (nothing is appended then)
+        int Append(BlockManager& bm, const char* data, int size);
+        // get the offset of the next data at or after offset
+        // returns -1 if there is no more data
+        int SeekData(const BlockManager& bm, int offset) const;
+        // get the offset of the next hole at or after offset (the end of the file counts as one)
+        // returns -1 if offset is past the end of the file
+        int SeekHole(const BlockManager& bm, int offset) const;
+        // shrink or grow the file to the given size, growing leaves a hole
+        // this and Preallocate fail once the file was removed
+        bool Truncate(BlockManager& bm, int size);
+        // reserve zeroed space for [offset, offset + size) ahead of writing it
+        bool Preallocate(BlockManager& bm, int offset, int size);
+        // flush delayed writes as well as lazy timestamps
+        void Sync(BlockManager& bm) override;
+        // delayed writes are dropped instead of being flushed
+        void FreeDatablocks(BlockManager& bm) override;
+        void CollectBlocks(BlockManager& bm, std::vector<unsigned int>& block_nums) override;
+        void Detach(BlockManager& bm) override;
+
+	private: // only Directory can make a new file
+		File(BlockManager& bm, unsigned int inode_block);
+		File(BlockManager& bm, int owner, int permissions, unsigned int block_num = 0);
+		File(BlockManager& bm, const File& src, int owner);
+
+        // Append with the file to itself, for appends that change more of the inode than its end
+        int AppendExclusive(BlockManager& bm, const char* data, int size);
+        // undo an append whose data couldn't all be written
+        void AbortAppend(BlockManager& bm, unsigned int offset, int size);
+        // a copy of the inode for operations that only hold the lock in read mode
+        // appends grow its size and blocks under mtx meanwhile, so it can't be read directly without it
+        Inode CurrentInode() const;
+
+        // just for QoL
+        static FilePtr Load(BlockManager& bm, int inode_block)
+        {
+            return std::make_unique<File>(File(bm, inode_block));
+        }
+
+    private:
+        // data written with delalloc that has no blocks allocated yet
+        Inode::PendingBlocks pending;
+        // keeps reads and in-place writes of the same blocks apart while they share the element's lock
+        mutable RangeLock range_lock;
+	};
+}
+
+
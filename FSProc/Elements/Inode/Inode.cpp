@@ -1,235 +1,677 @@
-#include "Inode.h"
-using namespace FS;
-
-#include <string.h>
-#include <cmath>
-
-Inode Inode::Load(const BlockManager& bm, unsigned int block_num)
-{
-    // create a default inode
-	Inode in;
-    // create an empty block to write to disk
-	char buf[Disk::BlockSize];
-    // read thwe inode from the disk into the block
-	bm.Read(block_num, &buf);
-    // copy the inode data into the inode
-	memcpy(&in, buf, sizeof(Inode));
-	return in;
-}
-
-Inode Inode::Create(BlockManager& bm, unsigned int block_num, 
-	ElementType type, int owner, int permissions)
-{
-    // create a default inode
-	Inode in;
-    // create an empty block
-	char buf[Disk::BlockSize] = {};
-	
-	// init default metadata struct
-	const time_t t = time(NULL);
-	in.mtd = { type, owner, permissions, 0, t, t, t };
-
-    // copy the inode onto the block and write it to disk
-	memcpy(&buf, &in, sizeof(Inode));
-	bm.Write(block_num, buf);
-	return in;
-}
-
-unsigned int FS::Inode::Write(BlockManager& bm, unsigned int inode_block,
-	unsigned int offset, const void* data, unsigned int data_size)
-{
-	// sanity check
-	if (offset > mtd.size)
-		offset = mtd.size;
-
-	// allocate as many blocks as needed (if any) for this new data and update size
-	if (offset + data_size > mtd.size)
-	{
-		const unsigned int new_size = offset + data_size;
-		const unsigned int new_num_blocks = (unsigned int)std::ceil(float(new_size) / Disk::BlockSize);
-		if (new_num_blocks > num_blocks)
-			AddNewBlocks(bm, inode_block, new_num_blocks - num_blocks);
-		if (num_blocks == new_num_blocks)
-			mtd.size = new_size;
-		else // in case enough blocks were not allocated (because disk ran out of space)
-		{
-			mtd.size = new_num_blocks * Disk::BlockSize;
-			data_size = mtd.size - offset;
-		}
-		Save(bm, inode_block);
-	}
-
-	// some needed initializations
-	char buf[Disk::BlockSize] = {};
-	unsigned int data_offset = 0; // index for the data array
-	const unsigned int block_idx = (unsigned int)std::floor(float(offset) / Disk::BlockSize); // the block idx to start writing from
-	const unsigned int block_num = GetBlockNum(bm, block_idx); // actual block num on disk to start writing from
-
-	if (block_num == 0) // well rip, no space left
-		return 0;
-
-	// load the block to start writing from
-	bm.Read(block_num, buf);
-
-	// write this first block
-	const unsigned int block_offset = offset % Disk::BlockSize;
-	const unsigned int cpy_size = std::min(Disk::BlockSize - block_offset, data_size);
-	memcpy(buf + block_offset, data, cpy_size);
-	bm.Write(block_num, buf);
-	data_offset += cpy_size;
-
-	// write the remaining blocks
-	for (unsigned int i = block_idx + 1; i < num_blocks && data_offset < data_size; i++, data_offset += Disk::BlockSize)
-	{
-		memcpy(buf, (char*)data + data_offset,
-			std::min(Disk::BlockSize, data_size - data_offset)
-		);
-		bm.Write(GetBlockNum(bm, i), buf);
-	}
-
-	return data_size;
-}
-
-unsigned int FS::Inode::Read(const BlockManager& bm, unsigned int offset, void* data, unsigned int data_size) const
-{
-	if (offset >= mtd.size)
-		return 0;
-
-	// some needed initializations
-	char buf[Disk::BlockSize] = {};
-	unsigned int data_offset = 0; // index for the data array
-	const unsigned int block_idx = (unsigned int)std::floor(float(offset) / Disk::BlockSize); // the block idx to start writing from
-	const unsigned int block_num = GetBlockNum(bm, block_idx); // actual block num on disk to start writing from
-
-	// copy this first block
-	const unsigned int block_offset = offset % Disk::BlockSize;
-	const unsigned int cpy_size = std::min(Disk::BlockSize - block_offset, data_size);
-	bm.Read(block_num, buf);
-	memcpy(data, buf + block_offset, cpy_size);
-	data_offset += cpy_size;
-
-	// copy the remaining blocks
-	for (unsigned int i = block_idx + 1; i < num_blocks && data_offset < data_size; i++, data_offset += Disk::BlockSize)
-	{
-		bm.Read(GetBlockNum(bm, i), buf);
-		memcpy((char*)data + data_offset, buf,
-			std::min(Disk::BlockSize, data_size - data_offset)
-		);
-	}
-
-	return data_size;
-}
-
-void Inode::FreeAll(BlockManager& bm, unsigned int inode_block)
-{
-    for(int i = 0; i < num_blocks; i++)
-    {
-        bm.FreeBlock(GetBlockNum(bm, i));
-    }
-    num_blocks = 0;
-    mtd.size = 0;
-    Save(bm, inode_block);
-}
-
-unsigned int FS::Inode::GetSize() const
-{
-	return mtd.size;
-}
-
-unsigned int FS::Inode::GetSizeOnDisk() const
-{
-	return num_blocks * Disk::BlockSize;
-}
-
-ElementType Inode::GetType() const
-{
-    return mtd.type;
-}
-
-Inode::Metadata Inode::GetMetadata() const
-{
-	return mtd;
-}
-
-void FS::Inode::AddNewBlock(BlockManager& bm, unsigned int inode_block)
-{
-    // allocate a block
-	const unsigned int block_num = bm.AlloateFreeBlock();
-	
-    // if there are direct blocks left to be allocated allocate one
-	if (num_blocks < NumDirectBlocks)
-	{
-		blocks[num_blocks++] = block_num;
-	}
-	else if (num_blocks < NumDirectBlocks + NumIndirectBlocks) // otherwise allocate an indirect block
-	{
-		// allocate indir block if it doesn't exist
-		if (indir == 0)
-			indir = bm.AlloateFreeBlock();
-		
-		// load indir block
-		unsigned int buf[Disk::BlockSize / sizeof(int)] = {};
-		bm.Read(indir, buf);
-
-		// update indir block
-		buf[num_blocks - NumDirectBlocks] = block_num;
-		bm.Write(indir, buf);
-		num_blocks++;
-	}
-    // update the inode on the disk
-	Save(bm, inode_block);
-}
-
-void FS::Inode::AddNewBlocks(BlockManager& bm, unsigned int inode_block, unsigned int num_blocks)
-{
-	for (unsigned int i = 0; i < num_blocks; i++)
-		AddNewBlock(bm, inode_block);
-}
-
-void Inode::RemoveLastBlock(BlockManager& bm, unsigned int inode_block)
-{
-	if (num_blocks <= 0)
-		return;
-	else if (num_blocks <= 12)
-	{
-		bm.FreeBlock(blocks[--num_blocks]);
-		return;
-	}
-	Save(bm, inode_block);
-}
-
-unsigned int Inode::GetBlockNum(const BlockManager& bm, unsigned int idx) const
-{
-	if (idx < 12)
-	{
-		return blocks[idx];
-	}
-	else if (idx < NumDirectBlocks + NumIndirectBlocks)
-	{
-		// load indir block
-		unsigned int buf[Disk::BlockSize / sizeof(int)] = {};
-		bm.Read(indir, buf);
-		// return the block_num at idx - NumDirectBlocks
-		return buf[idx - NumDirectBlocks];
-	}
-	return 0;
-}
-
-void Inode::Save(BlockManager& bm, unsigned int block_num)
-{
-	char buf[Disk::BlockSize] = {};
-	memcpy(buf, this, sizeof(Inode));
-	bm.Write(block_num, buf);
-}
-
-void FS::Inode::UpdateTimeModified(BlockManager& bm, unsigned int inode_block)
-{
-	mtd.accessed = time(NULL);
-	Save(bm, inode_block);
-}
-
-void FS::Inode::UpdateTimeAccessed(BlockManager& bm, unsigned int inode_block)
-{
-	mtd.accessed = time(NULL);
-	Save(bm, inode_block);
-}
+#include "Inode.h"
+using namespace FS;
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+Inode Inode::Load(const BlockManager& bm, unsigned int block_num)
+{
+    // create a default inode
+	Inode in;
+    // create an empty block to write to disk
+	char buf[Disk::BlockSize];
+    // read thwe inode from the disk into the block
+	bm.Read(block_num, &buf);
+    // copy the inode data into the inode
+	memcpy(&in, buf, sizeof(Inode));
+	in.times_dirty = false;
+	return in;
+}
+
+std::vector<Inode::Metadata> Inode::LoadMetadata(const BlockManager& bm, const std::vector<unsigned int>& block_nums)
+{
+	// visit the blocks in sorted order, remembering where each one goes
+	std::vector<size_t> order(block_nums.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), 
+		[&](size_t a, size_t b) { return block_nums[a] < block_nums[b]; });
+
+	std::vector<Metadata> res(block_nums.size());
+	// the longest run read at once
+	constexpr unsigned int MaxRun = 16;
+	char buf[MaxRun * Disk::BlockSize];
+	Inode in;
+	for (size_t i = 0; i < order.size(); )
+	{
+		// extend the run while the next block follows the last one (duplicates included)
+		const unsigned int first = block_nums[order[i]];
+		size_t j = i + 1;
+		while (j < order.size() && block_nums[order[j]] - first < MaxRun && 
+			block_nums[order[j]] - block_nums[order[j - 1]] <= 1)
+			j++;
+		bm.ReadBlocks(first, block_nums[order[j - 1]] - first + 1, buf);
+		for (; i < j; i++)
+		{
+			memcpy(&in, buf + (block_nums[order[i]] - first) * Disk::BlockSize, sizeof(Inode));
+			res[order[i]] = in.mtd;
+		}
+	}
+	return res;
+}
+
+Inode Inode::Create(BlockManager& bm, unsigned int block_num, 
+	ElementType type, int owner, int permissions)
+{
+    // create a default inode
+	Inode in;
+    // create an empty block
+	char buf[Disk::BlockSize] = {};
+	
+	// init default metadata struct
+	const time_t t = time(NULL);
+	in.mtd = { type, owner, permissions, 0, t, t, t };
+	in.generation = bm.NextGeneration();
+
+    // copy the inode onto the block and write it to disk
+	memcpy(&buf, &in, sizeof(Inode));
+	bm.Write(block_num, buf);
+	return in;
+}
+
+bool Inode::Clone(BlockManager& bm, const Inode& src, unsigned int block_num, int owner, Inode& out)
+{
+	Inode in = src;
+	const time_t t = time(NULL);
+	in.mtd.owner = owner;
+	in.mtd.created = in.mtd.modified = in.mtd.accessed = t;
+	in.generation = bm.NextGeneration();
+
+	// the clone gets its own indirect block, only the data blocks are shared
+	std::vector<unsigned int> data_blocks;
+	for (unsigned int i = 0; i < NumDirectBlocks; i++)
+	{
+		if (in.blocks[i] != 0)
+			data_blocks.push_back(in.blocks[i]);
+	}
+	if (src.indir != 0)
+	{
+		unsigned int buf[NumIndirectBlocks] = {};
+		bm.Read(src.indir, buf);
+		for (unsigned int i = 0; i < NumIndirectBlocks; i++)
+		{
+			if (buf[i] != 0)
+				data_blocks.push_back(buf[i]);
+		}
+		in.indir = bm.AlloateFreeBlock();
+		if (in.indir == 0)
+			return false;
+		bm.Write(in.indir, buf);
+	}
+
+	// nothing is copied, both inodes now own every data block
+	if (!bm.ShareBlocks(data_blocks))
+	{
+		if (in.indir != 0)
+			bm.FreeBlock(in.indir);
+		return false;
+	}
+
+	in.Save(bm, block_num);
+	out = in;
+	return true;
+}
+
+unsigned int FS::Inode::Write(BlockManager& bm, unsigned int inode_block,
+	unsigned int offset, const void* data, unsigned int data_size)
+{
+	// the file can't grow past the blocks the inode is able to track
+	if (offset >= MaxSize)
+		return 0;
+	data_size = std::min(data_size, MaxSize - offset);
+
+	// writing past the end is allowed, anything between the old end and offset is left as a hole
+	// holes are never allocated, only the blocks this write actually touches are
+	char buf[Disk::BlockSize] = {};
+	bool inode_changed = false;
+	unsigned int data_offset = 0; // index for the data array
+	while (data_offset < data_size)
+	{
+		const unsigned int block_idx = (offset + data_offset) / Disk::BlockSize;
+		const unsigned int block_offset = (offset + data_offset) % Disk::BlockSize;
+		const unsigned int cpy_size = std::min(Disk::BlockSize - block_offset, data_size - data_offset);
+
+		unsigned int block_num = GetBlockNum(bm, block_idx);
+		if (block_num == 0)
+		{
+			// fill the hole with a new block, whatever this write doesn't cover must read as zeros
+			block_num = AddNewBlock(bm, block_idx);
+			if (block_num == 0) // well rip, no space left
+				break;
+			memset(buf, 0, Disk::BlockSize);
+			inode_changed = true;
+		}
+		else
+		{
+			// partially written block, keep the rest of its data
+			if (cpy_size < Disk::BlockSize)
+				bm.Read(block_num, buf);
+			// the block is shared with a clone, write to a private copy instead
+			if (bm.BlockIsShared(block_num))
+			{
+				block_num = UnshareBlock(bm, block_idx, block_num);
+				if (block_num == 0)
+					break;
+				inode_changed = true;
+			}
+		}
+
+		memcpy(buf + block_offset, (const char*)data + data_offset, cpy_size);
+		bm.Write(block_num, buf);
+		data_offset += cpy_size;
+	}
+
+	// update the size if the file grew
+	if (offset + data_offset > mtd.size)
+	{
+		mtd.size = offset + data_offset;
+		inode_changed = true;
+	}
+	if (inode_changed)
+		Save(bm, inode_block);
+
+	return data_offset;
+}
+
+unsigned int Inode::WriteDelayed(BlockManager& bm, unsigned int inode_block,
+	unsigned int offset, const void* data, unsigned int data_size, PendingBlocks& pending)
+{
+	if (offset >= MaxSize)
+		return 0;
+	data_size = std::min(data_size, MaxSize - offset);
+
+	char buf[Disk::BlockSize] = {};
+	bool inode_changed = false;
+	unsigned int data_offset = 0; // index for the data array
+	while (data_offset < data_size)
+	{
+		const unsigned int block_idx = (offset + data_offset) / Disk::BlockSize;
+		const unsigned int block_offset = (offset + data_offset) % Disk::BlockSize;
+		const unsigned int cpy_size = std::min(Disk::BlockSize - block_offset, data_size - data_offset);
+
+		auto it = pending.find(block_idx);
+		unsigned int block_num = it == pending.end() ? GetBlockNum(bm, block_idx) : 0;
+		if (it == pending.end() && block_num == 0)
+		{
+			// reserve a block for the hole (and the indirect block if this is the first pending index
+			// that will need it) but leave choosing which one until the flush
+			const unsigned int num_reserve = NumReservedBlocks(pending) == pending.size() && 
+				indir == 0 && block_idx >= NumDirectBlocks ? 2 : 1;
+			if (!bm.ReserveBlocks(num_reserve))
+				break;
+			it = pending.emplace(block_idx, PendingBlocks::mapped_type{}).first;
+		}
+
+		if (it != pending.end())
+		{
+			memcpy(it->second.data() + block_offset, (const char*)data + data_offset, cpy_size);
+		}
+		else
+		{
+			// already allocated blocks are written through the same way as Write
+			if (cpy_size < Disk::BlockSize)
+				bm.Read(block_num, buf);
+			if (bm.BlockIsShared(block_num))
+			{
+				block_num = UnshareBlock(bm, block_idx, block_num);
+				if (block_num == 0)
+					break;
+				inode_changed = true;
+			}
+			memcpy(buf + block_offset, (const char*)data + data_offset, cpy_size);
+			bm.Write(block_num, buf);
+		}
+		data_offset += cpy_size;
+	}
+
+	// the size is saved along with the pending data when it is flushed
+	mtd.size = std::max(mtd.size, offset + data_offset);
+	if (inode_changed)
+		Save(bm, inode_block);
+
+	return data_offset;
+}
+
+void Inode::FlushPending(BlockManager& bm, unsigned int inode_block, PendingBlocks& pending)
+{
+	if (pending.empty())
+		return;
+
+	// the final size is known by now, so all the blocks are chosen in one allocator call
+	// this can't fail, the blocks were reserved when the data was written
+	const unsigned int num_reserved = NumReservedBlocks(pending);
+	std::vector<unsigned int> block_nums;
+	bm.AllocateBlocks(num_reserved, block_nums, true);
+
+	// the pending data is ordered by index so it ends up in consecutive blocks
+	unsigned int indir_buf[NumIndirectBlocks] = {};
+	const bool uses_indir = pending.rbegin()->first >= NumDirectBlocks;
+	if (num_reserved > pending.size())
+		indir = block_nums.back();
+	else if (uses_indir)
+		bm.Read(indir, indir_buf);
+
+	auto block_it = block_nums.begin();
+	for (auto& p : pending)
+	{
+		bm.Write(*block_it, p.second.data());
+		if (p.first < NumDirectBlocks)
+			blocks[p.first] = *block_it;
+		else
+			indir_buf[p.first - NumDirectBlocks] = *block_it;
+		block_it++;
+	}
+	if (uses_indir)
+		bm.Write(indir, indir_buf);
+	num_blocks += pending.size();
+	pending.clear();
+
+	Save(bm, inode_block);
+}
+
+void Inode::DiscardPending(BlockManager& bm, PendingBlocks& pending)
+{
+	bm.UnreserveBlocks(NumReservedBlocks(pending));
+	pending.clear();
+}
+
+unsigned int Inode::NumReservedBlocks(const PendingBlocks& pending) const
+{
+	const bool needs_indir = indir == 0 && !pending.empty() && pending.rbegin()->first >= NumDirectBlocks;
+	return pending.size() + (needs_indir ? 1 : 0);
+}
+
+unsigned int FS::Inode::Read(const BlockManager& bm, unsigned int offset, void* data, unsigned int data_size, 
+	const PendingBlocks* pending) const
+{
+	if (offset >= mtd.size)
+		return 0;
+	// never read past the end of the file
+	data_size = std::min(data_size, mtd.size - offset);
+
+	char buf[Disk::BlockSize] = {};
+	unsigned int data_offset = 0; // index for the data array
+	while (data_offset < data_size)
+	{
+		const unsigned int block_idx = (offset + data_offset) / Disk::BlockSize;
+		const unsigned int block_offset = (offset + data_offset) % Disk::BlockSize;
+		const unsigned int cpy_size = std::min(Disk::BlockSize - block_offset, data_size - data_offset);
+
+		const auto it = pending ? pending->find(block_idx) : PendingBlocks::const_iterator();
+		if (pending && it != pending->end())
+		{
+			// data that hasn't been given a block yet
+			memcpy((char*)data + data_offset, it->second.data() + block_offset, cpy_size);
+		}
+		else if (const unsigned int block_num = GetBlockNum(bm, block_idx))
+		{
+			bm.Read(block_num, buf);
+			memcpy((char*)data + data_offset, buf + block_offset, cpy_size);
+		}
+		else
+		{
+			// holes read as zeros without touching the disk
+			memset((char*)data + data_offset, 0, cpy_size);
+		}
+		data_offset += cpy_size;
+	}
+
+	return data_size;
+}
+
+int Inode::SeekData(const BlockManager& bm, unsigned int offset, const PendingBlocks* pending) const
+{
+	// look for the first allocated (or pending) block at or after offset
+	for (unsigned int i = offset / Disk::BlockSize; i * Disk::BlockSize < mtd.size; i++)
+	{
+		if ((pending && pending->count(i)) || GetBlockNum(bm, i) != 0)
+			return std::max(offset, i * Disk::BlockSize);
+	}
+	// nothing but holes until the end of the file
+	return -1;
+}
+
+int Inode::SeekHole(const BlockManager& bm, unsigned int offset, const PendingBlocks* pending) const
+{
+	if (offset >= mtd.size)
+		return -1;
+	// look for the first unallocated block at or after offset that isn't pending either
+	for (unsigned int i = offset / Disk::BlockSize; i * Disk::BlockSize < mtd.size; i++)
+	{
+		if (!(pending && pending->count(i)) && GetBlockNum(bm, i) == 0)
+			return std::max(offset, i * Disk::BlockSize);
+	}
+	// there is always an implicit hole at the end of the file
+	return mtd.size;
+}
+
+bool Inode::Truncate(BlockManager& bm, unsigned int inode_block, unsigned int new_size)
+{
+	if (new_size > MaxSize)
+		return false;
+
+	if (new_size < mtd.size)
+	{
+		// drop every block past the new end (including any preallocated past the old end)
+		// truncating to zero just frees everything without touching the data
+		FreeBlocksFrom(bm, (new_size + Disk::BlockSize - 1) / Disk::BlockSize);
+
+		// zero the rest of the new last block so growing the file again reads zeros there
+		const unsigned int tail = new_size % Disk::BlockSize;
+		unsigned int block_num = tail != 0 ? GetBlockNum(bm, new_size / Disk::BlockSize) : 0;
+		if (block_num != 0)
+		{
+			char buf[Disk::BlockSize] = {};
+			bm.Read(block_num, buf);
+			memset(buf + tail, 0, Disk::BlockSize - tail);
+			// don't zero the data of a clone sharing the block
+			if (bm.BlockIsShared(block_num))
+				block_num = UnshareBlock(bm, new_size / Disk::BlockSize, block_num);
+			if (block_num != 0)
+				bm.Write(block_num, buf);
+		}
+	}
+	// growing only moves the end, the new range is a hole
+
+	mtd.size = new_size;
+	Save(bm, inode_block);
+	return true;
+}
+
+bool Inode::Preallocate(BlockManager& bm, unsigned int inode_block, unsigned int offset, unsigned int len, 
+	bool zero_fill)
+{
+	if (offset > MaxSize || len > MaxSize - offset)
+		return false;
+	if (len == 0)
+		return true;
+
+	const unsigned int first_idx = offset / Disk::BlockSize;
+	const unsigned int end_idx = (offset + len + Disk::BlockSize - 1) / Disk::BlockSize;
+
+	// find the holes in the range, the indirect block is loaded once and written back once
+	unsigned int indir_buf[NumIndirectBlocks] = {};
+	const bool uses_indir = end_idx > NumDirectBlocks;
+	if (uses_indir && indir != 0)
+		bm.Read(indir, indir_buf);
+	std::vector<unsigned int> holes;
+	for (unsigned int i = first_idx; i < end_idx; i++)
+	{
+		const unsigned int block_num = i < NumDirectBlocks ? blocks[i] : indir_buf[i - NumDirectBlocks];
+		if (block_num == 0)
+			holes.push_back(i);
+	}
+
+	// reserve everything in a single allocator call so the blocks end up next to each other
+	const bool new_indir = uses_indir && indir == 0;
+	std::vector<unsigned int> block_nums;
+	if (!bm.AllocateBlocks(holes.size() + new_indir, block_nums))
+		return false;
+
+	auto it = block_nums.begin();
+	if (new_indir)
+		indir = *it++;
+	// reserved blocks must read as zeros until they are written to
+	// blocks only partly in the range are zeroed either way, the rest of them would show up if the file grew
+	const char zeros[Disk::BlockSize] = {};
+	for (unsigned int idx : holes)
+	{
+		const bool covered = idx * Disk::BlockSize >= offset && (idx + 1) * Disk::BlockSize <= offset + len;
+		if (zero_fill || !covered)
+			bm.Write(*it, zeros);
+		if (idx < NumDirectBlocks)
+			blocks[idx] = *it;
+		else
+			indir_buf[idx - NumDirectBlocks] = *it;
+		it++;
+	}
+	if (uses_indir)
+		bm.Write(indir, indir_buf);
+	num_blocks += holes.size();
+
+	// like fallocate without KEEP_SIZE, the file grows to cover the range
+	mtd.size = std::max(mtd.size, offset + len);
+	Save(bm, inode_block);
+	return true;
+}
+
+void Inode::FreeAll(BlockManager& bm, unsigned int inode_block)
+{
+	FreeBlocksFrom(bm, 0);
+    mtd.size = 0;
+    Save(bm, inode_block);
+}
+
+bool Inode::IsOverwrite(const BlockManager& bm, unsigned int offset, unsigned int data_size) const
+{
+	if (data_size == 0 || offset >= mtd.size || data_size > mtd.size - offset)
+		return false;
+	for (unsigned int idx = offset / Disk::BlockSize; idx <= (offset + data_size - 1) / Disk::BlockSize; idx++)
+	{
+		const unsigned int block_num = GetBlockNum(bm, idx);
+		if (block_num == 0 || bm.BlockIsShared(block_num))
+			return false;
+	}
+	return true;
+}
+
+void Inode::CollectBlocks(const BlockManager& bm, std::vector<unsigned int>& block_nums) const
+{
+	for (unsigned int i = 0; i < NumDirectBlocks; i++)
+	{
+		if (blocks[i] != 0)
+			block_nums.push_back(blocks[i]);
+	}
+	if (indir != 0)
+	{
+		unsigned int buf[NumIndirectBlocks] = {};
+		bm.Read(indir, buf);
+		for (unsigned int i = 0; i < NumIndirectBlocks; i++)
+		{
+			if (buf[i] != 0)
+				block_nums.push_back(buf[i]);
+		}
+		block_nums.push_back(indir);
+	}
+}
+
+unsigned int FS::Inode::GetSize() const
+{
+	return mtd.size;
+}
+
+unsigned int FS::Inode::GetSizeOnDisk() const
+{
+	return num_blocks * Disk::BlockSize;
+}
+
+ElementType Inode::GetType() const
+{
+    return mtd.type;
+}
+
+unsigned int Inode::GetGeneration() const
+{
+    return generation;
+}
+
+Inode::Metadata Inode::GetMetadata() const
+{
+	return mtd;
+}
+
+unsigned int FS::Inode::AddNewBlock(BlockManager& bm, unsigned int idx)
+{
+    // allocate a block
+	const unsigned int block_num = bm.AlloateFreeBlock();
+	if (block_num == 0)
+		return 0;
+
+    // point the given index to it (this may need a new indirect block)
+	if (!SetBlockNum(bm, idx, block_num))
+	{
+		bm.FreeBlock(block_num);
+		return 0;
+	}
+	num_blocks++;
+	return block_num;
+}
+
+void Inode::FreeBlocksFrom(BlockManager& bm, unsigned int first_idx)
+{
+	// every block is collected first so the block manager only has to write the superblock once
+	std::vector<unsigned int> freed;
+	for (unsigned int i = first_idx; i < NumDirectBlocks; i++)
+	{
+		if (blocks[i] != 0)
+			freed.push_back(blocks[i]);
+		blocks[i] = 0;
+	}
+	if (indir != 0)
+	{
+		unsigned int buf[NumIndirectBlocks] = {};
+		bm.Read(indir, buf);
+		bool indir_empty = true;
+		const unsigned int first_indir_idx = first_idx > NumDirectBlocks ? first_idx - NumDirectBlocks : 0;
+		for (unsigned int i = 0; i < NumIndirectBlocks; i++)
+		{
+			if (buf[i] != 0 && i >= first_indir_idx)
+			{
+				freed.push_back(buf[i]);
+				buf[i] = 0;
+			}
+			else if (buf[i] != 0)
+			{
+				indir_empty = false;
+			}
+		}
+		num_blocks -= freed.size();
+
+		// the indirect block goes as well once it tracks nothing
+		if (indir_empty)
+		{
+			freed.push_back(indir);
+			indir = 0;
+		}
+		else
+		{
+			bm.Write(indir, buf);
+		}
+	}
+	else
+	{
+		num_blocks -= freed.size();
+	}
+	bm.FreeBlocks(freed);
+}
+
+unsigned int Inode::UnshareBlock(BlockManager& bm, unsigned int idx, unsigned int block_num)
+{
+	const unsigned int new_block_num = bm.AlloateFreeBlock();
+	if (new_block_num == 0)
+		return 0;
+	SetBlockNum(bm, idx, new_block_num);
+	// drops this inode as an owner of the shared block
+	bm.FreeBlock(block_num);
+	return new_block_num;
+}
+
+unsigned int Inode::GetBlockNum(const BlockManager& bm, unsigned int idx) const
+{
+	if (idx < NumDirectBlocks)
+	{
+		return blocks[idx];
+	}
+	else if (idx < NumDirectBlocks + NumIndirectBlocks)
+	{
+		// no indirect block means all indirect indices are holes
+		if (indir == 0)
+			return 0;
+		// load indir block
+		unsigned int buf[Disk::BlockSize / sizeof(int)] = {};
+		bm.Read(indir, buf);
+		// return the block_num at idx - NumDirectBlocks
+		return buf[idx - NumDirectBlocks];
+	}
+	return 0;
+}
+
+bool Inode::SetBlockNum(BlockManager& bm, unsigned int idx, unsigned int block_num)
+{
+	if (idx < NumDirectBlocks)
+	{
+		blocks[idx] = block_num;
+		return true;
+	}
+	else if (idx < NumDirectBlocks + NumIndirectBlocks)
+	{
+		unsigned int buf[Disk::BlockSize / sizeof(int)] = {};
+		// allocate indir block if it doesn't exist
+		// it starts out zeroed so every index it tracks is a hole
+		if (indir == 0)
+		{
+			indir = bm.AlloateFreeBlock();
+			if (indir == 0)
+				return false;
+		}
+		else
+		{
+			bm.Read(indir, buf);
+		}
+
+		// update indir block
+		buf[idx - NumDirectBlocks] = block_num;
+		bm.Write(indir, buf);
+		return true;
+	}
+	return false;
+}
+
+void Inode::Save(BlockManager& bm, unsigned int block_num)
+{
+	// any timestamps kept in memory are flushed along with this write
+	times_dirty = false;
+	char buf[Disk::BlockSize] = {};
+	memcpy(buf, this, sizeof(Inode));
+	bm.Write(block_num, buf);
+}
+
+void Inode::SaveTimes(BlockManager& bm, unsigned int block_num)
+{
+	if (bm.GetMountOptions().lazytime)
+		times_dirty = true;
+	else
+		Save(bm, block_num);
+}
+
+void FS::Inode::UpdateTimeModified(BlockManager& bm, unsigned int inode_block)
+{
+	mtd.modified = time(NULL);
+	SaveTimes(bm, inode_block);
+}
+
+void FS::Inode::UpdateTimeAccessed(BlockManager& bm, unsigned int inode_block)
+{
+	const time_t t = time(NULL);
+	switch (bm.GetMountOptions().atime)
+	{
+	case AtimeMode::Noatime:
+		return;
+	case AtimeMode::Relatime:
+		// only update if the access time is older than the last modification or a day old
+		if (mtd.accessed > mtd.modified && t - mtd.accessed < 24 * 60 * 60)
+			return;
+		break;
+	case AtimeMode::Strict:
+		break;
+	}
+	mtd.accessed = t;
+	SaveTimes(bm, inode_block);
+}
+
+void FS::Inode::SyncTimes(BlockManager& bm, unsigned int inode_block)
+{
+	if (times_dirty)
+		Save(bm, inode_block);
+}
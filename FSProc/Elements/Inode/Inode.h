@@ -1,91 +1,170 @@
-#pragma once
-
-#include <BlockManager.h>
-#include <Disk.h>
-#include <FS.h>
-
-namespace FS
-{
-	class Inode
-	{
-        // maximum number of direct block pointers
-		static constexpr unsigned int NumDirectBlocks = 12;
-        // max number of indirect block pointers
-		static constexpr unsigned int NumIndirectBlocks = Disk::BlockSize / sizeof(int);
-		// with a heavy heart
-		friend class FSElement;
-	public:
-        // metadata about the file system element this inode belongs to
-		struct Metadata
-		{
-			ElementType type;
-			int owner;
-			int permissions;
-			unsigned int size;
-			time_t created;
-			time_t modified;
-			time_t accessed;
-		};
-
-	public:
-        // loads an inode from the given block idx
-		static Inode Load(const BlockManager& bm, unsigned int block_num);
-        // creates a new inode at the given block idx
-		static Inode Create(BlockManager& bm, unsigned int block_num, 
-			ElementType type, int owner, int permissions);
-        // writes data to the blocks tracked by the inode using the offset
-        // calculation for which block an offset falls in is done automatically
-		unsigned int Write(BlockManager& bm, unsigned int inode_block, 
-			unsigned int offset, const void* data, unsigned int data_size);
-        // reads data from the blocks tracked by the inode using the offset
-        // calculation for which block an offset falls in is done automatically
-		unsigned int Read(const BlockManager& bm, 
-            unsigned int offset, void* buf, unsigned int data_size) const;
-        // frees all allocated blocks to the inode
-        void FreeAll(BlockManager& bm, unsigned int inode_block);
-		// update the modification time in the metadata and save the inode
-		void UpdateTimeModified(BlockManager& bm, unsigned int block_num);
-		// update the access time in the metadata and save the inode
-		void UpdateTimeAccessed(BlockManager& bm, unsigned int block_num);
-        // get the size of the data tracked by the inode
-        // does not include the wasted space at the end of the last data block
-        // does not include the inode block itself
-		unsigned int GetSize() const;
-        // get the actual effective size of the data tracked by the inode
-        // accounts forthe space wasted at the end of the last data block
-        // does not include the inode block itself
-		unsigned int GetSizeOnDisk() const;
-        // get the type of the file system element pointed to by the inode
-        ElementType GetType() const;
-        // get the entire metadata of the file system element pointed to by the inode
-		Metadata GetMetadata() const;
-
-	private:
-        // the default constructor
-        // to ensure no inode is ever unitialized, this is kept private
-        // and is only accessible by the FSElement base class
-		Inode() = default;
-        // allocate a new block to the inode
-		void AddNewBlock(BlockManager& bm, unsigned int inode_block);
-        // allocate multiple blocks to the inode
-		void AddNewBlocks(BlockManager& bm, unsigned int inode_block, unsigned int num_blocks);
-        // remove the last alocated block
-		void RemoveLastBlock(BlockManager& bm, unsigned int inode_block);
-        // get the actual block number of the block on the given index
-		unsigned int GetBlockNum(const BlockManager& bm, unsigned int idx) const;
-		// writes the inode to disk
-		void Save(BlockManager& disk, unsigned int block_num);
-	private:
-		Metadata mtd = {};
-        // total number of data blocks aside form the inode block itself
-		unsigned int num_blocks = 0;
-        // indices of the direct blocks
-		unsigned int blocks[NumDirectBlocks] = {};
-        // index of the block with the indices to indirect blocks
-		unsigned int indir = 0;
-	};
-
-	struct data_pair : std::pair<std::string, Inode::Metadata> {};
-	std::ostream& operator<<(std::ostream& out, const FS::data_pair& dp);
-}
-
+#pragma once
+
+#include <BlockManager.h>
+#include <Disk.h>
+#include <FS.h>
+#include <array>
+#include <map>
+#include <vector>
+
+namespace FS
+{
+	class Inode
+	{
+        // maximum number of direct block pointers
+		static constexpr unsigned int NumDirectBlocks = 12;
+        // max number of indirect block pointers
+		static constexpr unsigned int NumIndirectBlocks = Disk::BlockSize / sizeof(int);
+        // largest size a file can grow to
+		static constexpr unsigned int MaxSize = (NumDirectBlocks + NumIndirectBlocks) * Disk::BlockSize;
+		// with a heavy heart
+		friend class FSElement;
+		friend class File;
+		friend class HashIndex;
+		friend class BTreeIndex;
+	public:
+        // metadata about the file system element this inode belongs to
+		struct Metadata
+		{
+			ElementType type;
+			int owner;
+			int permissions;
+			unsigned int size;
+			time_t created;
+			time_t modified;
+			time_t accessed;
+		};
+        // data written to blocks that are not allocated yet (delayed allocation), by block index
+		using PendingBlocks = std::map<unsigned int, std::array<char, Disk::BlockSize>>;
+
+	public:
+        // loads an inode from the given block idx
+		static Inode Load(const BlockManager& bm, unsigned int block_num);
+        // load just the metadata of the inodes at the given blocks (in the same order)
+        // the blocks are read in sorted order, each run of consecutive blocks with a single disk access
+		static std::vector<Metadata> LoadMetadata(const BlockManager& bm, const std::vector<unsigned int>& block_nums);
+        // creates a new inode at the given block idx
+		static Inode Create(BlockManager& bm, unsigned int block_num, 
+			ElementType type, int owner, int permissions);
+        // creates a copy of src at the given block idx that shares all of its data blocks
+        // blocks are only copied once either inode writes to them
+        // returns false if there was no space for the copy's indirect block
+		static bool Clone(BlockManager& bm, const Inode& src, unsigned int block_num, 
+			int owner, Inode& out);
+        // writes data to the blocks tracked by the inode using the offset
+        // calculation for which block an offset falls in is done automatically
+        // writing past the end leaves a hole that takes up no blocks
+		unsigned int Write(BlockManager& bm, unsigned int inode_block, 
+			unsigned int offset, const void* data, unsigned int data_size);
+        // same as Write, except data for unallocated blocks is kept in pending instead
+        // a free block is reserved for every new pending block so flushing can't run out of space
+        // the new size is only kept in memory until FlushPending
+		unsigned int WriteDelayed(BlockManager& bm, unsigned int inode_block, 
+			unsigned int offset, const void* data, unsigned int data_size, PendingBlocks& pending);
+        // allocate blocks for all pending data in one go, write it out and save the inode
+		void FlushPending(BlockManager& bm, unsigned int inode_block, PendingBlocks& pending);
+        // drop all pending data and give back the blocks reserved for it
+		void DiscardPending(BlockManager& bm, PendingBlocks& pending);
+        // reads data from the blocks tracked by the inode using the offset
+        // calculation for which block an offset falls in is done automatically
+        // holes read as zeros without any disk access
+        // pending data (if given) is read instead of the hole it will fill
+		unsigned int Read(const BlockManager& bm, 
+            unsigned int offset, void* buf, unsigned int data_size, 
+            const PendingBlocks* pending = nullptr) const;
+        // get the offset of the first byte of data at or after offset
+        // returns -1 if there is only holes from offset to the end of the file
+		int SeekData(const BlockManager& bm, unsigned int offset, 
+			const PendingBlocks* pending = nullptr) const;
+        // get the offset of the first byte of a hole at or after offset
+        // the end of the file counts as a hole, returns -1 if offset is past the end
+		int SeekHole(const BlockManager& bm, unsigned int offset, 
+			const PendingBlocks* pending = nullptr) const;
+        // check if writing [offset, offset + data_size) only overwrites data in allocated blocks that aren't shared
+        // such a write changes nothing about the inode itself
+        bool IsOverwrite(const BlockManager& bm, unsigned int offset, unsigned int data_size) const;
+        // frees all allocated blocks to the inode
+        void FreeAll(BlockManager& bm, unsigned int inode_block);
+        // append every allocated block (including the indirect one) to block_nums so they can be freed in a batch
+        // the inode itself is left as it is, it must not be used afterwards
+        void CollectBlocks(const BlockManager& bm, std::vector<unsigned int>& block_nums) const;
+        // shrink or grow the data to new_size
+        // shrinking frees the blocks past the new end, growing leaves a hole
+        // returns false if new_size is larger than a file can be
+		bool Truncate(BlockManager& bm, unsigned int inode_block, unsigned int new_size);
+        // allocate zeroed blocks for every hole in [offset, offset + len) and grow the size to cover it
+        // all blocks are reserved in one allocator call so they are contiguous if possible
+        // without zero_fill the blocks the range covers whole are left as they are, for a caller that writes all of it next
+        // returns false (without allocating anything) if there isn't enough space
+		bool Preallocate(BlockManager& bm, unsigned int inode_block, unsigned int offset, unsigned int len, 
+			bool zero_fill = true);
+		// update the modification time in the metadata and save the inode
+		// with lazytime the save is deferred until the next SyncTimes or Save
+		void UpdateTimeModified(BlockManager& bm, unsigned int block_num);
+		// update the access time in the metadata according to the atime mount option
+		// and save the inode (deferred with lazytime)
+		void UpdateTimeAccessed(BlockManager& bm, unsigned int block_num);
+		// save the inode if it has timestamp changes that were kept in memory
+		void SyncTimes(BlockManager& bm, unsigned int block_num);
+        // get the size of the data tracked by the inode
+        // does not include the wasted space at the end of the last data block
+        // does not include the inode block itself
+		unsigned int GetSize() const;
+        // get the actual effective size of the data tracked by the inode
+        // accounts forthe space wasted at the end of the last data block
+        // does not include the inode block itself
+		unsigned int GetSizeOnDisk() const;
+        // get the type of the file system element pointed to by the inode
+        ElementType GetType() const;
+        // get the entire metadata of the file system element pointed to by the inode
+		Metadata GetMetadata() const;
+        // get the number telling this inode apart from earlier ones in the same block
+		unsigned int GetGeneration() const;
+
+	private:
+        // the default constructor
+        // to ensure no inode is ever unitialized, this is kept private
+        // and is only accessible by the FSElement base class
+		Inode() = default;
+        // allocate a new block to the inode at the given index (must currently be a hole)
+        // returns the allocated block number or 0 if no space is left, does not save the inode
+		unsigned int AddNewBlock(BlockManager& bm, unsigned int idx);
+        // replace a shared block with a newly allocated one, the caller writes the data to it
+        // returns the new block number or 0 if no space is left, does not save the inode
+		unsigned int UnshareBlock(BlockManager& bm, unsigned int idx, unsigned int block_num);
+        // number of blocks reserved for the given pending data
+        // this includes the indirect block if one will need to be allocated when flushing
+		unsigned int NumReservedBlocks(const PendingBlocks& pending) const;
+        // free every allocated block at or after the given index, does not save the inode
+		void FreeBlocksFrom(BlockManager& bm, unsigned int first_idx);
+        // get the actual block number of the block on the given index
+        // returns 0 if the index is a hole
+		unsigned int GetBlockNum(const BlockManager& bm, unsigned int idx) const;
+        // point the given index to a block number, allocating the indirect block if needed
+        // returns false if the index is out of range or the indirect block couldn't be allocated
+		bool SetBlockNum(BlockManager& bm, unsigned int idx, unsigned int block_num);
+		// writes the inode to disk
+		void Save(BlockManager& disk, unsigned int block_num);
+		// save the inode now or mark its timestamps dirty depending on the lazytime option
+		void SaveTimes(BlockManager& bm, unsigned int block_num);
+	private:
+		Metadata mtd = {};
+        // total number of allocated data blocks aside form the inode block itself
+        // holes are not counted
+		unsigned int num_blocks = 0;
+        // indices of the direct blocks (0 for a hole)
+		unsigned int blocks[NumDirectBlocks] = {};
+        // index of the block with the indices to indirect blocks (0 if none are allocated)
+		unsigned int indir = 0;
+        // set anew whenever the block is used for a new inode, so a handle to a removed element
+        // can't reach whatever was created in its place (0 for inodes from before it was kept)
+		unsigned int generation = 0;
+		// set when timestamps were updated in memory but not yet saved (lazytime)
+		// meaningless on disk, cleared on load and on every save
+		bool times_dirty = false;
+	};
+
+	struct data_pair : std::pair<std::string, Inode::Metadata> {};
+	std::ostream& operator<<(std::ostream& out, const FS::data_pair& dp);
+}
+
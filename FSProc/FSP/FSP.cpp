@@ -1,400 +1,1177 @@
-#include <FSP.h>
-#include <iostream>
-#include <string.h>
-#include <unistd.h>
-#include <sstream>
-#include <sys/shm.h>
-
-#define FS_RETURN(val) ReturnValue((p_idx), (val)); return;
-
-void* RegistrationRedirect(void* params);
-void* ServiceRedirect(void* params);
-
-FSP::FSP()
-	:
-	inf(filename)
-{
-    qid = msgget(FSIPC::regq_key, IPC_CREAT | FSIPC::regq_permissions);
-    if(qid == -1)
-    {
-        perror("msgget");
-        exit(EXIT_FAILURE);
-    }
-
-    sem_init(&mtx, 0, 1);
-    sem_init(&copy_sem, 0, 0);
-
-    if(pthread_create(&registration_thread, NULL, RegistrationRedirect, this) == -1)
-    {
-        perror("pthread_create");
-    }
-}
-
-FSP::~FSP()
-{
-    sem_wait(&mtx);
-    running = false;
-    sem_post(&mtx);
-
-    sem_destroy(&copy_sem);
-    sem_destroy(&mtx);
-
-    if(pthread_join(registration_thread, NULL))
-    {
-        perror("pthread_join");
-    }
-    msgctl(qid, IPC_RMID, NULL);
-}
-
-void FSP::Run()
-{
-    getchar();
-}
-
-void* FSP::Registration(void* params)
-{
-    FSIPC::RequestBuf rbuf = {};
-
-    while(true)
-    {
-        sem_wait(&mtx);
-        if(!running)
-        {
-            sem_post(&mtx);
-            break;
-        }
-        sem_post(&mtx);
-
-        if(msgrcv(qid, &rbuf, sizeof(rbuf) - sizeof(rbuf.mtype), 1, IPC_NOWAIT) == -1)
-        {
-            if(errno != ENOMSG)
-            {
-                std::ostringstream oss;
-                oss << "[Listener] msgrcv";
-                perror(oss.str().c_str());
-                return NULL;
-            }
-        }
-        else
-        {
-            ServiceThreadParams p = {
-                ._this = this, .proc_idx = processes.size()
-            };
-
-            processes.push_back(Process{ 
-                .pid = rbuf.pid,
-                .uid = rbuf.uid,
-                .qid = rbuf.qid,
-            });
-
-            pthread_create(&processes.back().t, NULL, ServiceRedirect, &p);
-            sem_wait(&copy_sem);
-            //sleep(1);
-        }
-    }
-    return NULL;
-}
-
-void* FSP::Service(void* params)
-{
-    const int p_idx = ((ServiceThreadParams*)params)->proc_idx;
-    sem_post(&copy_sem);
-
-    FSIPC::CommandBuf cbuf;
-    bool end = false;
-    while(!end)
-    {
-        sem_wait(&mtx);
-        end = !running;
-        sem_post(&mtx);
-
-        if(msgrcv(processes[p_idx].qid, &cbuf, sizeof(cbuf.params), -9, IPC_NOWAIT) == -1)
-        {
-            if(errno != ENOMSG)
-            {
-                std::ostringstream oss;
-                oss << "[" << p_idx << "] msgrcv";
-                perror(oss.str().c_str());
-                return NULL;
-            }
-        }
-        else
-        {
-            switch (cbuf.mtype)
-            {
-                case FSIPC::Type::Open:
-                {
-                    FSIPC::OpenParameters p;
-                    memcpy(&p, cbuf.params, sizeof(p));
-                    Open(p_idx, p);
-                    break;
-                }
-                case FSIPC::Type::Close:
-                {
-                    FSIPC::CloseParameters p;
-                    memcpy(&p, cbuf.params, sizeof(p));
-                    Close(p_idx, p);
-                    break;
-                }
-                case FSIPC::Type::Read:
-                {
-                    FSIPC::ReadParameters p;
-                    memcpy(&p, cbuf.params, sizeof(p));
-                    Read(p_idx, p);
-                    break;
-                }
-                case FSIPC::Type::Write:
-                {
-                    FSIPC::WriteParameters p;
-                    memcpy(&p, cbuf.params, sizeof(p));
-                    Write(p_idx, p);
-                    break;
-                }
-                case FSIPC::Type::Create:
-                {
-                    FSIPC::CreateParameters p;
-                    memcpy(&p, cbuf.params, sizeof(p));
-                    Create(p_idx, p);
-                    break;
-                }
-                case FSIPC::Type::Remove:
-                {
-                    FSIPC::RemoveParameters p;
-                    memcpy(&p, cbuf.params, sizeof(p));
-                    Remove(p_idx, p);
-                    break;
-                }
-                case FSIPC::Type::List:
-                {
-                    FSIPC::ListParameters p;
-                    memcpy(&p, cbuf.params, sizeof(p));
-                    List(p_idx, p);
-                    break;
-                }
-                case FSIPC::Type::ErrorInfo:
-                {
-                    FSIPC::ErrorInfoParameters p;
-                    memcpy(&p, cbuf.params, sizeof(p));
-
-                    break;
-                }
-                case FSIPC::Type::Exit:
-                {
-                    return NULL;
-                    break;
-                }
-            }
-        }
-    }
-    return NULL;
-}
-
-void FSP::Open(int p_idx, FSIPC::OpenParameters p)
-{
-    std::ostringstream log_stream;
-    log_stream << "[" << p_idx << "] Open ";
-
-    const char* path = (char*)shmat(p.path_shmid, NULL, 0);
-    if(path == (char*)-1)
-    {
-        FS_RETURN(-1);
-    }
-
-    log_stream << "[Path] " << path << " ";
-
-    const int fd = inf.Open(path);
-    if(fd == -1)
-    {
-        shmdt(path);
-        FS_RETURN(-1);
-    }
-    shmdt(path);
-
-    const int f_idx = processes[p_idx].opened.size();
-    processes[p_idx].opened.push_back(fd);
-
-    log_stream << "[FD] " << fd << " [F_IDX] " << f_idx << std::endl;
-    std::cout << log_stream.str();
-
-    FS_RETURN(f_idx);
-}
-
-void FSP::Close(int p_idx, FSIPC::CloseParameters p)
-{
-    std::ostringstream log_stream;
-    log_stream << "[" << p_idx << "] Close ";
-
-    if(p.f_idx < 0 || p.f_idx >= processes[p_idx].opened.size())
-    {
-        FS_RETURN(-1);
-    }
-
-    log_stream << "[F_IDX] " << p.f_idx << std::endl;
-    std::cout << log_stream.str();
-
-    inf.Close(processes[p_idx].opened[p.f_idx]);
-    FS_RETURN(0);
-}
-
-void FSP::Read(int p_idx, FSIPC::ReadParameters p)
-{
-    std::ostringstream log_stream;
-    log_stream << "[" << p_idx << "] Read ";
-
-    if(p.f_idx < 0 || p.f_idx >= processes[p_idx].opened.size())
-    {
-        FS_RETURN(-1);
-    }
-
-    char* buf = (char*)shmat(p.buf_shmid, NULL, 0);
-    if(buf == (char*)-1)
-    {
-        FS_RETURN(-1);
-    }
-
-    const int num = inf.Read(processes[p_idx].opened[p.f_idx], buf, 0, p.size);
-    
-    log_stream << "[F_IDX] " << p.f_idx << " [Num] " << num << std::endl;
-    std::cout << log_stream.str();
-
-    shmdt(buf);
-    FS_RETURN(num);
-}
-
-void FSP::Write(int p_idx, FSIPC::WriteParameters p)
-{
-    std::ostringstream log_stream;
-    log_stream << "[" << p_idx << "] Write [F_IDX] " << p.f_idx << " [size] " << p.size << " ";
-
-    if(p.f_idx < 0 || p.f_idx >= processes[p_idx].opened.size())
-    {
-        FS_RETURN(-1);
-    }
-
-    const char* buf = (char*)shmat(p.buf_shmid, NULL, 0);
-    if(buf == (char*)-1)
-    {
-        FS_RETURN(-1);
-    }
-
-    const int num = inf.Write(processes[p_idx].opened[p.f_idx], buf, 0, p.size);
-
-    log_stream << "[Num] " << num << std::endl;
-    std::cout << log_stream.str();
-
-    shmdt(buf);
-    FS_RETURN(num);
-}
-
-void FSP::Create(int p_idx, FSIPC::CreateParameters p)
-{
-    std::ostringstream log_stream;
-    log_stream << "[" << p_idx << "] Create [Type] " << p.etype << " ";
-
-    const char* path = (char*)shmat(p.path_shmid, NULL, 0);
-    if(path == (char*)-1)
-    {
-        FS_RETURN(-1);
-    }
-
-    log_stream << "[Path] " << path << std::endl;
-    std::cout << log_stream.str();
-
-    FS::ElementType e;
-    if(p.etype == 'F')
-    {
-        e = FS::ElementType::File;
-    }
-    else if(p.etype == 'D')
-    {
-        e = FS::ElementType::Directory;
-    }
-    else
-    {
-        shmdt(path);
-        FS_RETURN(-1);
-    }
-
-    int res = (int)inf.Add(path, e, processes[p_idx].uid, p.permissions);
-    shmdt(path);
-    FS_RETURN(res);
-}
-
-void FSP::Remove(int p_idx, FSIPC::RemoveParameters p)
-{
-    const char* path = (char*)shmat(p.path_shmid, NULL, 0);
-    if(path == (char*)-1)
-    {
-        FS_RETURN(-1);
-    }
-    bool res = inf.Remove(path);
-    shmdt(path);
-    FS_RETURN(res);
-}
-
-void FSP::List(int p_idx, FSIPC::ListParameters p)
-{
-    std::ostringstream log_stream;
-    log_stream << "[" << p_idx << "] List [F_IDX] " << p.f_idx << " ";
-
-    if(p.f_idx < 0 || p.f_idx >= processes[p_idx].opened.size())
-    {
-        FS_RETURN(-1);
-    }
-    
-    char* shm = (char*)shmat(p.listing_shmid, NULL, 0);
-    if(shm == (char*)-1)
-    {
-        FS_RETURN(-1);
-    }
-
-    const auto list = inf.List(processes[p_idx].opened[p.f_idx]);
-    std::ostringstream list_stream;
-    const std::string path = inf.GetPathString(processes[p_idx].opened[p.f_idx]);
-    for(size_t i = 0; i < list.size(); i++)
-    {
-        std::string child_path = path;
-        if(child_path.back() != '/')
-            child_path += "/";
-        child_path += list[i];
-        int fd = inf.Open(child_path);
-        list_stream << "[" << (inf.GetType(fd) == FS::ElementType::Directory ? 'D' : 'F')  << "]"<< list[i] << " ";
-        inf.Close(fd);
-    }
-
-    const std::string& res = list_stream.str();
-    strncpy(shm, res.c_str(), p.size);
-    shmdt(shm);
-    int retval = std::min(int(res.size()), p.size);
-
-    log_stream << "[Num] " << retval << std::endl;
-    std::cout << log_stream.str();
-
-    FS_RETURN(retval + 1);
-}
-
-void FSP::ErrorInfo(int p_idx, FSIPC::ErrorInfoParameters p)
-{
-    
-}
-
-void FSP::ReturnValue(int p_idx, int val)
-{
-    FSIPC::ReturnBuf rbuf = { .mtype = 10, .retval = val };
-    if(msgsnd(processes[p_idx].qid, &rbuf, sizeof(rbuf.retval), 0) == -1)
-    {
-        perror("msgsnd");
-    }
-}
-
-void* RegistrationRedirect(void* params)
-{
-    FSP* _this = (FSP*)params;
-    return _this->Registration(params);
-}
-
-void* ServiceRedirect(void* params)
-{
-    FSP* _this = ((FSP::ServiceThreadParams*)params)->_this;
-    return _this->Service(params);
+#include <FSP.h>
+#include <iostream>
+#include <string.h>
+#include <unistd.h>
+#include <sstream>
+#include <limits>
+#include <sys/shm.h>
+
+#define FS_RETURN(val) ReturnValue((p_idx), (val)); return;
+
+void* RegistrationRedirect(void* params);
+void* ServiceRedirect(void* params);
+
+// size of the ListPlusRecord sent for an entry with the given name
+static int ListPlusRecordLength(const std::string& name)
+{
+    return (sizeof(FSIPC::ListPlusRecord) + name.size() + 7) / 8 * 8;
+}
+
+// write the ListPlusRecord for an entry to dst, returns its size
+static int PackListPlusRecord(char* dst, const FS::Directory::EntryInfo& e)
+{
+    FSIPC::ListPlusRecord rec = {};
+    rec.rec_len = ListPlusRecordLength(e.name);
+    rec.type = e.metadata.type == FS::ElementType::Directory ? 'D' : 'F';
+    rec.name_len = e.name.size();
+    rec.owner = e.metadata.owner;
+    rec.permissions = e.metadata.permissions;
+    rec.size = e.metadata.size;
+    rec.created = e.metadata.created;
+    rec.modified = e.metadata.modified;
+    rec.accessed = e.metadata.accessed;
+    memcpy(dst, &rec, sizeof(rec));
+    memcpy(dst + sizeof(rec), e.name.data(), e.name.size());
+    return rec.rec_len;
+}
+
+static FSIPC::StatRecord MakeStatRecord(const FS::Inode::Metadata& mtd)
+{
+    FSIPC::StatRecord rec = {};
+    rec.type = mtd.type == FS::ElementType::Directory ? 'D' : 'F';
+    rec.owner = mtd.owner;
+    rec.permissions = mtd.permissions;
+    rec.size = mtd.size;
+    rec.created = mtd.created;
+    rec.modified = mtd.modified;
+    rec.accessed = mtd.accessed;
+    return rec;
+}
+
+FSP::FSP(const MountOptions& opts)
+	:
+	inf(filename, opts)
+{
+    qid = msgget(FSIPC::regq_key, IPC_CREAT | FSIPC::regq_permissions);
+    if(qid == -1)
+    {
+        perror("msgget");
+        exit(EXIT_FAILURE);
+    }
+
+    sem_init(&mtx, 0, 1);
+    sem_init(&copy_sem, 0, 0);
+
+    if(pthread_create(&registration_thread, NULL, RegistrationRedirect, this) == -1)
+    {
+        perror("pthread_create");
+    }
+}
+
+FSP::~FSP()
+{
+    sem_wait(&mtx);
+    running = false;
+    sem_post(&mtx);
+
+    sem_destroy(&copy_sem);
+    sem_destroy(&mtx);
+
+    if(pthread_join(registration_thread, NULL))
+    {
+        perror("pthread_join");
+    }
+    msgctl(qid, IPC_RMID, NULL);
+}
+
+void FSP::Run()
+{
+    getchar();
+}
+
+void* FSP::Registration(void* params)
+{
+    FSIPC::RequestBuf rbuf = {};
+
+    while(true)
+    {
+        sem_wait(&mtx);
+        if(!running)
+        {
+            sem_post(&mtx);
+            break;
+        }
+        sem_post(&mtx);
+
+        if(msgrcv(qid, &rbuf, sizeof(rbuf) - sizeof(rbuf.mtype), 1, IPC_NOWAIT) == -1)
+        {
+            if(errno != ENOMSG)
+            {
+                std::ostringstream oss;
+                oss << "[Listener] msgrcv";
+                perror(oss.str().c_str());
+                return NULL;
+            }
+        }
+        else
+        {
+            ServiceThreadParams p = {
+                ._this = this, .proc_idx = processes.size()
+            };
+
+            Process proc = {};
+            proc.pid = rbuf.pid;
+            proc.uid = rbuf.uid;
+            proc.qid = rbuf.qid;
+            processes.push_back(std::move(proc));
+
+            pthread_create(&processes.back().t, NULL, ServiceRedirect, &p);
+            sem_wait(&copy_sem);
+            //sleep(1);
+        }
+    }
+    return NULL;
+}
+
+void* FSP::Service(void* params)
+{
+    const int p_idx = ((ServiceThreadParams*)params)->proc_idx;
+    sem_post(&copy_sem);
+
+    FSIPC::CommandBuf cbuf;
+    bool end = false;
+    while(!end)
+    {
+        sem_wait(&mtx);
+        end = !running;
+        sem_post(&mtx);
+
+        if(msgrcv(processes[p_idx].qid, &cbuf, sizeof(cbuf.params), -(FSIPC::return_mtype - 1), IPC_NOWAIT) == -1)
+        {
+            if(errno != ENOMSG)
+            {
+                std::ostringstream oss;
+                oss << "[" << p_idx << "] msgrcv";
+                perror(oss.str().c_str());
+                return NULL;
+            }
+        }
+        else
+        {
+            switch (cbuf.mtype)
+            {
+                case FSIPC::Type::Open:
+                {
+                    FSIPC::OpenParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Open(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::Close:
+                {
+                    FSIPC::CloseParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Close(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::Read:
+                {
+                    FSIPC::ReadParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Read(p_idx, p, false);
+                    break;
+                }
+                case FSIPC::Type::PRead:
+                {
+                    FSIPC::ReadParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Read(p_idx, p, true);
+                    break;
+                }
+                case FSIPC::Type::Write:
+                {
+                    FSIPC::WriteParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Write(p_idx, p, false);
+                    break;
+                }
+                case FSIPC::Type::PWrite:
+                {
+                    FSIPC::WriteParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Write(p_idx, p, true);
+                    break;
+                }
+                case FSIPC::Type::Append:
+                {
+                    FSIPC::WriteParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Append(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::Seek:
+                {
+                    FSIPC::SeekOffsetParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Seek(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::OpenAt:
+                {
+                    FSIPC::OpenAtParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    OpenAt(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::CreateAt:
+                {
+                    FSIPC::CreateAtParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    CreateAt(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::RemoveAt:
+                {
+                    FSIPC::RemoveAtParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    RemoveAt(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::Stat:
+                {
+                    FSIPC::StatParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Stat(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::Fstat:
+                {
+                    FSIPC::FstatParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Fstat(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::GetHandle:
+                {
+                    FSIPC::GetHandleParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    GetHandle(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::OpenByHandle:
+                {
+                    FSIPC::OpenByHandleParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    OpenByHandle(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::Create:
+                {
+                    FSIPC::CreateParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Create(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::Remove:
+                {
+                    FSIPC::RemoveParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Remove(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::List:
+                {
+                    FSIPC::ListParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    List(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::ListPlus:
+                {
+                    FSIPC::ListParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    ListPlus(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::ListPage:
+                {
+                    FSIPC::ListParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    ListPage(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::SeekData:
+                {
+                    FSIPC::SeekParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    SeekData(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::SeekHole:
+                {
+                    FSIPC::SeekParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    SeekHole(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::Truncate:
+                {
+                    FSIPC::TruncateParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Truncate(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::Preallocate:
+                {
+                    FSIPC::PreallocateParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Preallocate(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::Clone:
+                {
+                    FSIPC::CloneParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Clone(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::Rename:
+                {
+                    FSIPC::RenameParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    Rename(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::CreateMany:
+                {
+                    FSIPC::CreateManyParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    CreateMany(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::ErrorInfo:
+                {
+                    FSIPC::ErrorInfoParameters p;
+                    memcpy(&p, cbuf.params, sizeof(p));
+                    ErrorInfo(p_idx, p);
+                    break;
+                }
+                case FSIPC::Type::Exit:
+                {
+                    return NULL;
+                    break;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+void FSP::Open(int p_idx, FSIPC::OpenParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] Open ";
+
+    const char* path = (char*)shmat(p.path_shmid, NULL, 0);
+    if(path == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+
+    log_stream << "[Path] " << path << " ";
+
+    const int fd = inf.Open(path);
+    if(fd == -1)
+    {
+        shmdt(path);
+        FS_RETURN(-1);
+    }
+    shmdt(path);
+
+    const int f_idx = processes[p_idx].opened.size();
+    processes[p_idx].opened.push_back({ fd, 0 });
+
+    log_stream << "[FD] " << fd << " [F_IDX] " << f_idx << std::endl;
+    std::cout << log_stream.str();
+
+    FS_RETURN(f_idx);
+}
+
+void FSP::Close(int p_idx, FSIPC::CloseParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] Close ";
+
+    if(!IsDescriptor(p_idx, p.f_idx) || processes[p_idx].opened[p.f_idx].handle == -1)
+    {
+        FS_RETURN(-1);
+    }
+
+    log_stream << "[F_IDX] " << p.f_idx << std::endl;
+    std::cout << log_stream.str();
+
+    inf.Close(processes[p_idx].opened[p.f_idx].handle);
+    // closing twice must not drop a reference someone else holds
+    processes[p_idx].opened[p.f_idx].handle = -1;
+    FS_RETURN(0);
+}
+
+void FSP::Read(int p_idx, FSIPC::ReadParameters p, bool positional)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] " << (positional ? "PRead " : "Read ");
+
+    if(!IsDescriptor(p_idx, p.f_idx) || p.size < 0)
+    {
+        FS_RETURN(-1);
+    }
+
+    auto& fd = processes[p_idx].opened[p.f_idx];
+    const long long offset = positional ? p.offset : fd.offset;
+    if(offset < 0)
+    {
+        FS_RETURN(-1);
+    }
+    // no file gets that large, so there is nothing to read there
+    if(offset > std::numeric_limits<int>::max() - p.size)
+    {
+        FS_RETURN(0);
+    }
+
+    char* buf = (char*)shmat(p.buf_shmid, NULL, 0);
+    if(buf == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+
+    const int num = inf.Read(fd.handle, buf, offset, p.size);
+    if(!positional && num > 0)
+        fd.offset += num;
+    
+    log_stream << "[F_IDX] " << p.f_idx << " [Offset] " << offset << " [Num] " << num << std::endl;
+    std::cout << log_stream.str();
+
+    shmdt(buf);
+    FS_RETURN(num);
+}
+
+void FSP::Write(int p_idx, FSIPC::WriteParameters p, bool positional)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] " << (positional ? "PWrite" : "Write") << " [F_IDX] " << p.f_idx << " [size] " << p.size << " ";
+
+    if(!IsDescriptor(p_idx, p.f_idx) || p.size < 0)
+    {
+        FS_RETURN(-1);
+    }
+
+    auto& fd = processes[p_idx].opened[p.f_idx];
+    const long long offset = positional ? p.offset : fd.offset;
+    if(offset < 0 || offset > std::numeric_limits<int>::max() - p.size)
+    {
+        FS_RETURN(-1);
+    }
+
+    const char* buf = (char*)shmat(p.buf_shmid, NULL, 0);
+    if(buf == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+
+    const int num = inf.Write(fd.handle, buf, offset, p.size);
+    if(!positional && num > 0)
+        fd.offset += num;
+
+    log_stream << "[Offset] " << offset << " [Num] " << num << std::endl;
+    std::cout << log_stream.str();
+
+    shmdt(buf);
+    FS_RETURN(num);
+}
+
+void FSP::Append(int p_idx, FSIPC::WriteParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] Append [F_IDX] " << p.f_idx << " [size] " << p.size << " ";
+
+    if(!IsDescriptor(p_idx, p.f_idx) || p.size < 0)
+    {
+        FS_RETURN(-1);
+    }
+
+    const char* buf = (char*)shmat(p.buf_shmid, NULL, 0);
+    if(buf == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+
+    auto& fd = processes[p_idx].opened[p.f_idx];
+    const int offset = inf.Append(fd.handle, buf, p.size);
+    shmdt(buf);
+    // like a write with O_APPEND, the descriptor is left past the data
+    if(offset != -1)
+        fd.offset = (long long)offset + p.size;
+
+    log_stream << "[Offset] " << offset << std::endl;
+    std::cout << log_stream.str();
+
+    FS_RETURN(offset);
+}
+
+void FSP::Seek(int p_idx, FSIPC::SeekOffsetParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] Seek [F_IDX] " << p.f_idx << " ";
+
+    if(!IsDescriptor(p_idx, p.f_idx))
+    {
+        FS_RETURN(-1);
+    }
+
+    auto& fd = processes[p_idx].opened[p.f_idx];
+    long long offset;
+    switch(p.whence)
+    {
+        case SEEK_SET: offset = p.offset; break;
+        case SEEK_CUR: offset = fd.offset + p.offset; break;
+        case SEEK_END: 
+        {
+            if(!inf.IsOpened(fd.handle))
+            {
+                FS_RETURN(-1);
+            }
+            offset = inf.GetSize(fd.handle) + p.offset; 
+            break;
+        }
+        default:
+        {
+            FS_RETURN(-1);
+        }
+    }
+    // the new offset is returned as an int, no file can be larger than that anyway
+    if(offset < 0 || offset > std::numeric_limits<int>::max())
+    {
+        FS_RETURN(-1);
+    }
+    fd.offset = offset;
+
+    log_stream << "[Offset] " << offset << std::endl;
+    std::cout << log_stream.str();
+
+    FS_RETURN(offset);
+}
+
+void FSP::Create(int p_idx, FSIPC::CreateParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] Create [Type] " << p.etype << " ";
+
+    const char* path = (char*)shmat(p.path_shmid, NULL, 0);
+    if(path == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+
+    log_stream << "[Path] " << path << std::endl;
+    std::cout << log_stream.str();
+
+    FS::ElementType e;
+    if(p.etype == 'F')
+    {
+        e = FS::ElementType::File;
+    }
+    else if(p.etype == 'D')
+    {
+        e = FS::ElementType::Directory;
+    }
+    else
+    {
+        shmdt(path);
+        FS_RETURN(-1);
+    }
+
+    int res = (int)inf.Add(path, e, processes[p_idx].uid, p.permissions);
+    shmdt(path);
+    FS_RETURN(res);
+}
+
+void FSP::Remove(int p_idx, FSIPC::RemoveParameters p)
+{
+    const char* path = (char*)shmat(p.path_shmid, NULL, 0);
+    if(path == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+    bool res = inf.Remove(path);
+    shmdt(path);
+    FS_RETURN(res);
+}
+
+void FSP::OpenAt(int p_idx, FSIPC::OpenAtParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] OpenAt [DIR_F_IDX] " << p.dir_f_idx << " ";
+
+    if(!IsDescriptor(p_idx, p.dir_f_idx))
+    {
+        FS_RETURN(-1);
+    }
+
+    const char* path = (char*)shmat(p.path_shmid, NULL, 0);
+    if(path == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+
+    log_stream << "[Path] " << path << " ";
+
+    const int fd = inf.OpenAt(processes[p_idx].opened[p.dir_f_idx].handle, path);
+    shmdt(path);
+    if(fd == -1)
+    {
+        FS_RETURN(-1);
+    }
+
+    const int f_idx = processes[p_idx].opened.size();
+    processes[p_idx].opened.push_back({ fd, 0 });
+
+    log_stream << "[FD] " << fd << " [F_IDX] " << f_idx << std::endl;
+    std::cout << log_stream.str();
+
+    FS_RETURN(f_idx);
+}
+
+void FSP::CreateAt(int p_idx, FSIPC::CreateAtParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] CreateAt [DIR_F_IDX] " << p.dir_f_idx << " [Type] " << p.etype << " ";
+
+    if(!IsDescriptor(p_idx, p.dir_f_idx))
+    {
+        FS_RETURN(-1);
+    }
+
+    FS::ElementType e;
+    if(p.etype == 'F')
+    {
+        e = FS::ElementType::File;
+    }
+    else if(p.etype == 'D')
+    {
+        e = FS::ElementType::Directory;
+    }
+    else
+    {
+        FS_RETURN(-1);
+    }
+
+    const char* path = (char*)shmat(p.path_shmid, NULL, 0);
+    if(path == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+
+    log_stream << "[Path] " << path << std::endl;
+    std::cout << log_stream.str();
+
+    int res = (int)inf.AddAt(processes[p_idx].opened[p.dir_f_idx].handle, path, e, 
+        processes[p_idx].uid, p.permissions);
+    shmdt(path);
+    FS_RETURN(res);
+}
+
+void FSP::RemoveAt(int p_idx, FSIPC::RemoveAtParameters p)
+{
+    if(!IsDescriptor(p_idx, p.dir_f_idx))
+    {
+        FS_RETURN(-1);
+    }
+
+    const char* path = (char*)shmat(p.path_shmid, NULL, 0);
+    if(path == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+    bool res = inf.RemoveAt(processes[p_idx].opened[p.dir_f_idx].handle, path);
+    shmdt(path);
+    FS_RETURN(res);
+}
+
+void FSP::Stat(int p_idx, FSIPC::StatParameters p)
+{
+    char* shm = (char*)shmat(p.shmid, NULL, 0);
+    if(shm == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+
+    FS::Inode::Metadata mtd;
+    if(!inf.Stat(shm, mtd))
+    {
+        shmdt(shm);
+        FS_RETURN(-1);
+    }
+    // the path isn't needed anymore, the record goes in its place
+    const FSIPC::StatRecord rec = MakeStatRecord(mtd);
+    memcpy(shm, &rec, sizeof(rec));
+    shmdt(shm);
+    FS_RETURN(0);
+}
+
+void FSP::Fstat(int p_idx, FSIPC::FstatParameters p)
+{
+    if(!IsDescriptor(p_idx, p.f_idx))
+    {
+        FS_RETURN(-1);
+    }
+
+    FS::Inode::Metadata mtd;
+    if(!inf.Fstat(processes[p_idx].opened[p.f_idx].handle, mtd))
+    {
+        FS_RETURN(-1);
+    }
+
+    char* shm = (char*)shmat(p.shmid, NULL, 0);
+    if(shm == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+    const FSIPC::StatRecord rec = MakeStatRecord(mtd);
+    memcpy(shm, &rec, sizeof(rec));
+    shmdt(shm);
+    FS_RETURN(0);
+}
+
+void FSP::GetHandle(int p_idx, FSIPC::GetHandleParameters p)
+{
+    if(!IsDescriptor(p_idx, p.f_idx))
+    {
+        FS_RETURN(-1);
+    }
+
+    FS::Interface::FileHandle fh;
+    if(!inf.GetFileHandle(processes[p_idx].opened[p.f_idx].handle, fh))
+    {
+        FS_RETURN(-1);
+    }
+
+    char* shm = (char*)shmat(p.shmid, NULL, 0);
+    if(shm == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+    const FSIPC::FileHandle rec = { fh.inode_block, fh.generation };
+    memcpy(shm, &rec, sizeof(rec));
+    shmdt(shm);
+    FS_RETURN(0);
+}
+
+void FSP::OpenByHandle(int p_idx, FSIPC::OpenByHandleParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] OpenByHandle [Inode] " << p.inode_block << 
+        " [Generation] " << p.generation << " ";
+
+    const int fd = inf.OpenByHandle({ p.inode_block, p.generation });
+    if(fd == -1)
+    {
+        FS_RETURN(-1);
+    }
+
+    const int f_idx = processes[p_idx].opened.size();
+    processes[p_idx].opened.push_back({ fd, 0 });
+
+    log_stream << "[FD] " << fd << " [F_IDX] " << f_idx << std::endl;
+    std::cout << log_stream.str();
+
+    FS_RETURN(f_idx);
+}
+
+void FSP::List(int p_idx, FSIPC::ListParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] List [F_IDX] " << p.f_idx << " ";
+
+    if(!IsDescriptor(p_idx, p.f_idx))
+    {
+        FS_RETURN(-1);
+    }
+    
+    char* shm = (char*)shmat(p.listing_shmid, NULL, 0);
+    if(shm == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+
+    // the types come along with the listing, no need to open every child
+    const auto list = inf.ListPlus(processes[p_idx].opened[p.f_idx].handle);
+    std::ostringstream list_stream;
+    for(size_t i = 0; i < list.size(); i++)
+    {
+        list_stream << "[" << (list[i].metadata.type == FS::ElementType::Directory ? 'D' : 'F')  << "]"<< list[i].name << " ";
+    }
+
+    const std::string& res = list_stream.str();
+    strncpy(shm, res.c_str(), p.size);
+    shmdt(shm);
+    int retval = std::min(int(res.size()), p.size);
+
+    log_stream << "[Num] " << retval << std::endl;
+    std::cout << log_stream.str();
+
+    FS_RETURN(retval + 1);
+}
+
+void FSP::ListPlus(int p_idx, FSIPC::ListParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] ListPlus [F_IDX] " << p.f_idx << " ";
+
+    if(!IsDescriptor(p_idx, p.f_idx))
+    {
+        FS_RETURN(-1);
+    }
+    
+    char* shm = (char*)shmat(p.listing_shmid, NULL, 0);
+    if(shm == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+
+    const auto list = inf.ListPlus(processes[p_idx].opened[p.f_idx].handle);
+    int pos = 0;
+    for(const auto& e : list)
+    {
+        // only whole records are sent
+        if(pos + ListPlusRecordLength(e.name) > p.size)
+            break;
+        pos += PackListPlusRecord(shm + pos, e);
+    }
+    shmdt(shm);
+
+    log_stream << "[Bytes] " << pos << std::endl;
+    std::cout << log_stream.str();
+
+    FS_RETURN(pos);
+}
+
+void FSP::ListPage(int p_idx, FSIPC::ListParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] ListPage [F_IDX] " << p.f_idx << " ";
+
+    if(!IsDescriptor(p_idx, p.f_idx))
+    {
+        FS_RETURN(-1);
+    }
+    
+    char* shm = (char*)shmat(p.listing_shmid, NULL, 0);
+    if(shm == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+
+    FSIPC::ListPageHeader lh;
+    memcpy(&lh, shm, sizeof(lh));
+    log_stream << "[Cookie] " << lh.cookie << " ";
+
+    // the page only holds what fits in the client's buffer, nothing else is kept around
+    int pos = 0;
+    int needed = 0;
+    std::vector<FS::Directory::EntryInfo> page;
+    const long long next = inf.ListPage(processes[p_idx].opened[p.f_idx].handle, lh.cookie, 
+        [&](const std::string& name) {
+            const int rec_len = ListPlusRecordLength(name);
+            if(pos + rec_len > p.size)
+            {
+                if(pos == 0)
+                    needed = rec_len;
+                return false;
+            }
+            pos += rec_len;
+            return true;
+        }, page);
+    // -1 for a bad descriptor, -2 for a stale cookie
+    if(next < 0)
+    {
+        shmdt(shm);
+        FS_RETURN((int)next);
+    }
+    // not even the first record fits, tell the client how big the buffer has to be
+    if(needed != 0)
+    {
+        shmdt(shm);
+        FS_RETURN(-needed);
+    }
+
+    char* records = shm + sizeof(lh);
+    pos = 0;
+    for(const auto& e : page)
+        pos += PackListPlusRecord(records + pos, e);
+    lh.cookie = next;
+    memcpy(shm, &lh, sizeof(lh));
+    shmdt(shm);
+
+    log_stream << "[Bytes] " << pos << std::endl;
+    std::cout << log_stream.str();
+
+    FS_RETURN(pos);
+}
+
+void FSP::SeekData(int p_idx, FSIPC::SeekParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] SeekData [F_IDX] " << p.f_idx << " [Offset] " << p.offset << " ";
+
+    if(!IsDescriptor(p_idx, p.f_idx))
+    {
+        FS_RETURN(-1);
+    }
+
+    const int res = inf.SeekData(processes[p_idx].opened[p.f_idx].handle, p.offset);
+
+    log_stream << "[Res] " << res << std::endl;
+    std::cout << log_stream.str();
+
+    FS_RETURN(res);
+}
+
+void FSP::SeekHole(int p_idx, FSIPC::SeekParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] SeekHole [F_IDX] " << p.f_idx << " [Offset] " << p.offset << " ";
+
+    if(!IsDescriptor(p_idx, p.f_idx))
+    {
+        FS_RETURN(-1);
+    }
+
+    const int res = inf.SeekHole(processes[p_idx].opened[p.f_idx].handle, p.offset);
+
+    log_stream << "[Res] " << res << std::endl;
+    std::cout << log_stream.str();
+
+    FS_RETURN(res);
+}
+
+void FSP::Truncate(int p_idx, FSIPC::TruncateParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] Truncate [F_IDX] " << p.f_idx << " [Size] " << p.size << " ";
+
+    if(!IsDescriptor(p_idx, p.f_idx))
+    {
+        FS_RETURN(-1);
+    }
+
+    const bool res = inf.Truncate(processes[p_idx].opened[p.f_idx].handle, p.size);
+
+    log_stream << "[Res] " << res << std::endl;
+    std::cout << log_stream.str();
+
+    FS_RETURN(res);
+}
+
+void FSP::Preallocate(int p_idx, FSIPC::PreallocateParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] Preallocate [F_IDX] " << p.f_idx 
+        << " [Offset] " << p.offset << " [Size] " << p.size << " ";
+
+    if(!IsDescriptor(p_idx, p.f_idx))
+    {
+        FS_RETURN(-1);
+    }
+
+    const bool res = inf.Preallocate(processes[p_idx].opened[p.f_idx].handle, p.offset, p.size);
+
+    log_stream << "[Res] " << res << std::endl;
+    std::cout << log_stream.str();
+
+    FS_RETURN(res);
+}
+
+void FSP::Clone(int p_idx, FSIPC::CloneParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] Clone ";
+
+    const char* src_path = (char*)shmat(p.src_path_shmid, NULL, 0);
+    if(src_path == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+    const char* dst_path = (char*)shmat(p.dst_path_shmid, NULL, 0);
+    if(dst_path == (char*)-1)
+    {
+        shmdt(src_path);
+        FS_RETURN(-1);
+    }
+
+    log_stream << "[Src] " << src_path << " [Dst] " << dst_path << std::endl;
+    std::cout << log_stream.str();
+
+    bool res = inf.Clone(src_path, dst_path, processes[p_idx].uid);
+    shmdt(dst_path);
+    shmdt(src_path);
+    FS_RETURN(res);
+}
+
+void FSP::CreateMany(int p_idx, FSIPC::CreateManyParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] CreateMany [Count] " << p.count << " ";
+
+    const char* path = (char*)shmat(p.path_shmid, NULL, 0);
+    if(path == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+    char* shm = (char*)shmat(p.entries_shmid, NULL, 0);
+    if(shm == (char*)-1)
+    {
+        shmdt(path);
+        FS_RETURN(-1);
+    }
+
+    log_stream << "[Path] " << path << std::endl;
+    std::cout << log_stream.str();
+
+    // the records are only walked as far as the segment goes, nothing is created if one doesn't fit in it
+    struct shmid_ds ds;
+    const size_t shm_size = shmctl(p.entries_shmid, IPC_STAT, &ds) == -1 ? 0 : ds.shm_segsz;
+    std::vector<FSIPC::CreateManyRecord> recs;
+    std::vector<size_t> rec_pos;
+    size_t pos = 0;
+    for(int i = 0; i < p.count; i++)
+    {
+        FSIPC::CreateManyRecord rec;
+        if(shm_size < sizeof(rec) || pos > shm_size - sizeof(rec))
+            break;
+        memcpy(&rec, shm + pos, sizeof(rec));
+        if(rec.rec_len < sizeof(rec) + rec.name_len || rec.rec_len > shm_size - pos)
+            break;
+        recs.push_back(rec);
+        rec_pos.push_back(pos);
+        pos += rec.rec_len;
+    }
+    if(recs.size() != (size_t)std::max(p.count, 0))
+    {
+        shmdt(shm);
+        shmdt(path);
+        FS_RETURN(-1);
+    }
+
+    // records with an unknown type are not passed on and fail like invalid names
+    std::vector<FS::Directory::NewEntry> entries;
+    std::vector<size_t> entry_rec;
+    for(size_t i = 0; i < recs.size(); i++)
+    {
+        const int result = -1;
+        memcpy(shm + rec_pos[i] + offsetof(FSIPC::CreateManyRecord, result), &result, sizeof(result));
+        if(recs[i].type == 'F' || recs[i].type == 'D')
+        {
+            entries.push_back({ std::string(shm + rec_pos[i] + sizeof(recs[i]), recs[i].name_len), 
+                recs[i].type == 'D' ? FS::ElementType::Directory : FS::ElementType::File, recs[i].permissions });
+            entry_rec.push_back(i);
+        }
+    }
+
+    std::vector<int> results;
+    int res = -1;
+    if(inf.AddMany(path, entries, processes[p_idx].uid, results))
+    {
+        res = 0;
+        for(size_t i = 0; i < results.size(); i++)
+        {
+            memcpy(shm + rec_pos[entry_rec[i]] + offsetof(FSIPC::CreateManyRecord, result), 
+                &results[i], sizeof(results[i]));
+            if(results[i] == 1)
+                res++;
+        }
+    }
+    shmdt(shm);
+    shmdt(path);
+    FS_RETURN(res);
+}
+
+void FSP::Rename(int p_idx, FSIPC::RenameParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] Rename ";
+
+    const char* old_path = (char*)shmat(p.old_path_shmid, NULL, 0);
+    if(old_path == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+    const char* new_path = (char*)shmat(p.new_path_shmid, NULL, 0);
+    if(new_path == (char*)-1)
+    {
+        shmdt(old_path);
+        FS_RETURN(-1);
+    }
+
+    log_stream << "[Old] " << old_path << " [New] " << new_path << std::endl;
+    std::cout << log_stream.str();
+
+    bool res = inf.Rename(old_path, new_path);
+    shmdt(new_path);
+    shmdt(old_path);
+    FS_RETURN(res);
+}
+
+void FSP::ErrorInfo(int p_idx, FSIPC::ErrorInfoParameters p)
+{
+    std::ostringstream log_stream;
+    log_stream << "[" << p_idx << "] ErrorInfo ";
+
+    if(p.buf_size <= 0)
+    {
+        FS_RETURN(-1);
+    }
+
+    char* buf = (char*)shmat(p.buf_shmid, NULL, 0);
+    if(buf == (char*)-1)
+    {
+        FS_RETURN(-1);
+    }
+
+    // each client is served by its own thread, so this is the error of its last call
+    const std::string err = inf.GetLastError();
+    const int num = std::min(int(err.size()), p.buf_size - 1);
+    memcpy(buf, err.c_str(), num);
+    buf[num] = '\0';
+    shmdt(buf);
+
+    log_stream << "[Num] " << num << std::endl;
+    std::cout << log_stream.str();
+
+    FS_RETURN(num);
+}
+
+void FSP::ReturnValue(int p_idx, int val)
+{
+    FSIPC::ReturnBuf rbuf = { .mtype = FSIPC::return_mtype, .retval = val };
+    if(msgsnd(processes[p_idx].qid, &rbuf, sizeof(rbuf.retval), 0) == -1)
+    {
+        perror("msgsnd");
+    }
+}
+
+bool FSP::IsDescriptor(int p_idx, int f_idx) const
+{
+    return f_idx >= 0 && (size_t)f_idx < processes[p_idx].opened.size();
+}
+
+void* RegistrationRedirect(void* params)
+{
+    FSP* _this = (FSP*)params;
+    return _this->Registration(params);
+}
+
+void* ServiceRedirect(void* params)
+{
+    FSP* _this = ((FSP::ServiceThreadParams*)params)->_this;
+    return _this->Service(params);
 }
\ No newline at end of file
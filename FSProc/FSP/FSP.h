@@ -1,63 +1,93 @@
-#pragma once
-
-#include <Interface.h>
-#include <sys/msg.h>
-#include <semaphore.h>
-#include <FSIPC_Structures.h>
-
-class FSP
-{
-    struct ServiceThreadParams
-    {
-        FSP* _this;
-        size_t proc_idx;
-    };
-
-    struct Process
-    {
-        int pid;
-        int uid;
-        key_t qid;
-        int shmid;
-        pthread_t t;
-        std::vector<int> opened;
-        std::string last_error;
-    };
-
-public:
-	FSP();
-	~FSP();
-	FSP(const FSP&) = delete;
-	FSP& operator=(const FSP&) = delete;
-
-	void Run();
-
-private:
-    friend void* RegistrationRedirect(void* params);
-    friend void* ServiceRedirect(void* params);
-
-    void* Registration(void* params);
-    void* Service(void* params);
-
-    void Open(int p_idx, FSIPC::OpenParameters p);
-    void Close(int p_idx, FSIPC::CloseParameters p);
-    void Read(int p_idx, FSIPC::ReadParameters p);
-    void Write(int p_idx, FSIPC::WriteParameters p);
-    void Create(int p_idx, FSIPC::CreateParameters p);
-    void Remove(int p_idx, FSIPC::RemoveParameters p);
-    void List(int p_idx, FSIPC::ListParameters p);
-    void ErrorInfo(int p_idx, FSIPC::ErrorInfoParameters p);
-    
-    void ReturnValue(int p_idx, int val);
-
-private:
-	const std::string filename = "TestFile";
-	FS::Interface inf;
-    int qid;
-    sem_t mtx;
-    sem_t oc_mtx;
-    sem_t copy_sem;
-    bool running = true;
-    std::vector<Process> processes;
-    pthread_t registration_thread;
-};
+#pragma once
+
+#include <Interface.h>
+#include <sys/msg.h>
+#include <semaphore.h>
+#include <FSIPC_Structures.h>
+
+class FSP
+{
+    struct ServiceThreadParams
+    {
+        FSP* _this;
+        size_t proc_idx;
+    };
+
+    struct Descriptor
+    {
+        // handle in the interface's opened table, -1 once closed
+        int handle;
+        // where Read and Write continue from
+        long long offset;
+    };
+
+    struct Process
+    {
+        int pid;
+        int uid;
+        key_t qid;
+        int shmid;
+        pthread_t t;
+        std::vector<Descriptor> opened;
+        std::string last_error;
+    };
+
+public:
+	FSP(const MountOptions& opts = {});
+	~FSP();
+	FSP(const FSP&) = delete;
+	FSP& operator=(const FSP&) = delete;
+
+	void Run();
+
+private:
+    friend void* RegistrationRedirect(void* params);
+    friend void* ServiceRedirect(void* params);
+
+    void* Registration(void* params);
+    void* Service(void* params);
+
+    void Open(int p_idx, FSIPC::OpenParameters p);
+    void Close(int p_idx, FSIPC::CloseParameters p);
+    // positional reads and writes use p.offset and leave the descriptor's offset alone
+    void Read(int p_idx, FSIPC::ReadParameters p, bool positional);
+    void Write(int p_idx, FSIPC::WriteParameters p, bool positional);
+    void Seek(int p_idx, FSIPC::SeekOffsetParameters p);
+    // p.offset is ignored, the data goes at the end of the file and the offset it went to is returned
+    void Append(int p_idx, FSIPC::WriteParameters p);
+    void Create(int p_idx, FSIPC::CreateParameters p);
+    void Remove(int p_idx, FSIPC::RemoveParameters p);
+    void OpenAt(int p_idx, FSIPC::OpenAtParameters p);
+    void CreateAt(int p_idx, FSIPC::CreateAtParameters p);
+    void RemoveAt(int p_idx, FSIPC::RemoveAtParameters p);
+    void Stat(int p_idx, FSIPC::StatParameters p);
+    void Fstat(int p_idx, FSIPC::FstatParameters p);
+    void GetHandle(int p_idx, FSIPC::GetHandleParameters p);
+    void OpenByHandle(int p_idx, FSIPC::OpenByHandleParameters p);
+    void List(int p_idx, FSIPC::ListParameters p);
+    void ListPlus(int p_idx, FSIPC::ListParameters p);
+    void ListPage(int p_idx, FSIPC::ListParameters p);
+    void SeekData(int p_idx, FSIPC::SeekParameters p);
+    void SeekHole(int p_idx, FSIPC::SeekParameters p);
+    void Truncate(int p_idx, FSIPC::TruncateParameters p);
+    void Preallocate(int p_idx, FSIPC::PreallocateParameters p);
+    void Clone(int p_idx, FSIPC::CloneParameters p);
+    void Rename(int p_idx, FSIPC::RenameParameters p);
+    void CreateMany(int p_idx, FSIPC::CreateManyParameters p);
+    void ErrorInfo(int p_idx, FSIPC::ErrorInfoParameters p);
+    
+    void ReturnValue(int p_idx, int val);
+    // check that f_idx is one of the descriptors handed out to the process (it may have been closed since)
+    bool IsDescriptor(int p_idx, int f_idx) const;
+
+private:
+	const std::string filename = "TestFile";
+	FS::Interface inf;
+    int qid;
+    sem_t mtx;
+    sem_t oc_mtx;
+    sem_t copy_sem;
+    bool running = true;
+    std::vector<Process> processes;
+    pthread_t registration_thread;
+};
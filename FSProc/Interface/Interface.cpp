@@ -2,20 +2,46 @@
 using namespace FS;
 
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <sstream>
 
-Interface::Interface(const std::string& disk_filename)
+thread_local std::string Interface::last_error;
+
+Interface::Interface(const std::string& disk_filename, const MountOptions& opts)
     :
     filename(disk_filename),
-    bm(d, filename)
+    bm(d, filename, opts),
+    dcache(DentryCacheSize),
+    reclaimer(bm, dcache, [this](unsigned int block_num){ DetachInode(block_num); })
 {
+    // timestamps (lazytime) and written data (delalloc) may only be kept in memory
+    // so they need to be written back periodically, directories are compacted at the same time
+    sync_thread = std::thread(&Interface::SyncLoop, this);
+
     auto root = FS::Directory::LoadRoot(bm);
 	if (root.get() == nullptr) // create root dir if it does not exist
 	{
-        auto root = FS::Directory::CreateRoot(bm, 0, 0x6);
-        return;
+        root = FS::Directory::CreateRoot(bm, 0, 0x6);
 	}
+    // root stays opened in the first slot (handle 0) for as long as the fs is mounted
+    // it's never looked up by path, so it isn't indexed
+    std::unique_lock<std::mutex> lock(opened[0].mtx);
+    const unsigned int root_block = root->GetInodeBlock();
+    inodes[root_block] = { NewSlot(0, "/", std::move(root), -1), false };
+}
+
+Interface::~Interface()
+{
+    {
+        std::unique_lock<std::mutex> lock(sync_mtx);
+        mounted = false;
+    }
+    sync_cv.notify_all();
+    if(sync_thread.joinable())
+        sync_thread.join();
+    // flush whatever the sync thread has not gotten to yet
+    Sync();
 }
 
 int Interface::Open(const std::string& path)
@@ -34,11 +60,6 @@ int Interface::Open(const std::string& path)
 
         return -1;
     }
-    
-    if(GetNumFSElements() == 0)
-    {
-        AddFSElement("/", Directory::LoadRoot(bm));
-    }
 
     int idx = Open(split_path);
     if(idx != -1)
@@ -57,12 +78,69 @@ int Interface::Open(const std::string& path)
 
 int Interface::Open(const std::vector<std::string>& split_path)
 {
-    // regenerate path starting at root (used to compare with entries in the opened list)
-    std::string new_path;
-    // the current index in the opened list that is opened
-    int cur_idx = 0;
+    return Walk(0, std::string(), split_path, 1);
+}
+
+int Interface::OpenAt(int dir_idx, const std::string& path)
+{
+    if(!path.empty() && path[0] == '/')
+        return Open(path);
+
+    const auto split_path = SplitPath(path);
+    if(std::any_of(split_path.begin(), split_path.end(), 
+        [](const std::string& str){ return str.empty(); })) // double '/' in path
+    {
+        std::ostringstream oss;
+        oss << path << ": invalid path";
+        last_error = oss.str();
+        return -1;
+    }
+    if(!IsOpened(dir_idx))
+    {
+        std::ostringstream oss;
+        oss << dir_idx << ": bad handle";
+        last_error = oss.str();
+        return -1;
+    }
+    if(GetType(dir_idx) != ElementType::Directory)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(dir_idx) << ": not a directory";
+        last_error = oss.str();
+        return -1;
+    }
+
+    // the walk starts at the directory instead of root, with a reference of its own
+    Retain(dir_idx);
+    std::string dir_path = GetPathString(dir_idx);
+    if(dir_path.empty())
+    {
+        std::ostringstream oss;
+        oss << path << ": the directory it's relative to has been removed";
+        last_error = oss.str();
+        Close(dir_idx);
+        return -1;
+    }
+    if(dir_path == "/")
+        dir_path.clear();
+
+    int idx = Walk(dir_idx, dir_path, split_path, 0);
+    if(idx != -1 && !path.empty() && path.back() == '/' && GetType(idx) != ElementType::Directory)
+    {
+        std::ostringstream oss;
+        oss << path << ": not a directory";
+        last_error = oss.str();
+        Close(idx);
+        return -1;
+    }
+    return idx;
+}
+
+int Interface::Walk(int cur_idx, std::string new_path, const std::vector<std::string>& split_path, size_t first)
+{
+    // new_path is regenerated along the way starting at root (used to look up entries in the opened list)
     // loop over the elements in the path
-    for(size_t i = 1; i < split_path.size(); i++)
+    for(size_t i = first; i < split_path.size(); i++)
     {
         // check if currently opened object is a directory in case a user treats a file as a dir
         if(GetType(cur_idx) != FS::ElementType::Directory)
@@ -76,11 +154,18 @@ int Interface::Open(const std::vector<std::string>& split_path)
         // add the new element into the generated path
         new_path += "/" + split_path[i];
         // check if file/dir has already been opened
-        int new_idx = GetIdx(new_path);
+        int new_idx = Acquire(new_path);
         // open the file/dir if not already opened
-        if(new_idx == GetNumFSElements())
+        if(new_idx == -1)
         {
-            auto ptr = GetPtr<Directory>(cur_idx)->Open(bm, split_path[i]);
+            const unsigned long dropped = num_dropped.load();
+            const unsigned long reclaimed = reclaimer.GetNumReclaimed();
+            auto dir_ptr = GetPtr<Directory>(cur_idx);
+            DentryCache::Dentry d;
+            FSElementPtr ptr;
+            // the cached entry is checked against the directory under its lock, so a removed element isn't loaded
+            if(Lookup(dir_ptr, split_path[i], d))
+                ptr = dir_ptr->Open(bm, split_path[i], d.block_num, d.type, d.unlink_stamp);
             if(ptr.get() == nullptr)
             {
                 std::ostringstream oss;
@@ -89,11 +174,23 @@ int Interface::Open(const std::vector<std::string>& split_path)
                 Close(cur_idx);
                 return -1;
             }
-            AddFSElement(new_path, std::move(ptr));
+            // the new element keeps the parent opened with the reference the walk held
+            new_idx = AddFSElement(new_path, std::move(ptr), cur_idx, dropped, reclaimed);
+            if(new_idx < 0)
+            {
+                std::ostringstream oss;
+                if(new_idx == -2)
+                    oss << new_path << ": no such file or directroy";
+                else
+                    oss << new_path << ": too many opened files and directories";
+                last_error = oss.str();
+                Close(cur_idx);
+                return -1;
+            }
         }
-        else // update num opened if already opened
+        else // already opened elements hold their own parent
         {
-            IncrementNumOpened(new_idx);
+            Close(cur_idx);
         }
         cur_idx = new_idx;
     }
@@ -103,20 +200,163 @@ int Interface::Open(const std::vector<std::string>& split_path)
 
 void Interface::Close(int idx)
 {
-    if(idx == 0)
-        return;
-    
-    auto split_path = SplitPath(GetPathString(idx));
-    std::string new_path = "/";
-    for(auto& e : split_path)
+    if(GetFCB(idx) != nullptr)
+        Release(idx);
+}
+
+bool Interface::Stat(const std::string& path, Inode::Metadata& mtd)
+{
+    std::string norm_path = path;
+    while(norm_path.size() > 1 && norm_path.back() == '/')
+        norm_path.pop_back();
+    if(norm_path.empty() || norm_path[0] != '/')
+    {
+        std::ostringstream oss;
+        oss << path << ": invalid path";
+        last_error = oss.str();
+        return false;
+    }
+    if(norm_path == "/")
+        return Fstat(0, mtd);
+
+    std::string name;
+    int parent_idx = OpenParent(0, norm_path, name);
+    if(parent_idx == -1)
     {
-        new_path += e + "/";
-        int i = GetIdx(new_path);
-        DecrementNumOpened(idx);
+        return false;
     }
-    
-    // remove any file or directory that is not currently opened by anyone
-    ClearOpened();
+    if(GetType(parent_idx) != ElementType::Directory)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(parent_idx) << ": not a directory";
+        last_error = oss.str();
+        Close(parent_idx);
+        return false;
+    }
+
+    // the inode is read under the parent's lock, so the entry isn't removed and its block reused in between
+    unsigned int block_num;
+    unsigned int generation;
+    if(!GetPtr<Directory>(parent_idx)->LookupMetadata(bm, name, block_num, mtd, generation))
+    {
+        std::ostringstream oss;
+        oss << path << ": no such file or directroy";
+        last_error = oss.str();
+        Close(parent_idx);
+        return false;
+    }
+    Close(parent_idx);
+
+    // an opened element may hold changes that aren't in its inode yet, however it was opened
+    // it's only used if the inode wasn't freed and reused by another element since it was read
+    int idx = -1;
+    {
+        std::unique_lock<std::mutex> lock(inodes_mtx);
+        auto it = inodes.find(block_num);
+        if(it != inodes.end())
+        {
+            idx = it->second.idx;
+            GetFCB(idx)->num_opened++;
+        }
+    }
+    if(idx != -1)
+    {
+        auto ptr = GetFCB(idx)->ptr.get();
+        if(ptr->GetGeneration(bm) == generation)
+            mtd = ptr->GetMetadata();
+        Close(idx);
+    }
+    return true;
+}
+
+bool Interface::Fstat(int idx, Inode::Metadata& mtd)
+{
+    auto fcb = GetFCB(idx);
+    if(fcb == nullptr)
+    {
+        std::ostringstream oss;
+        oss << idx << ": bad handle";
+        last_error = oss.str();
+        return false;
+    }
+    mtd = fcb->ptr->GetMetadata();
+    return true;
+}
+
+bool Interface::GetFileHandle(int idx, FileHandle& fh)
+{
+    auto fcb = GetFCB(idx);
+    if(fcb == nullptr)
+    {
+        std::ostringstream oss;
+        oss << idx << ": bad handle";
+        last_error = oss.str();
+        return false;
+    }
+    if(fcb->ptr->GetType() != ElementType::File)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": not a file";
+        last_error = oss.str();
+        return false;
+    }
+
+    // the handle of a removed file is handed out too, it's just never opened
+    fh.inode_block = fcb->ptr->GetInodeBlock();
+    fh.generation = fcb->ptr->GetGeneration(bm);
+    return true;
+}
+
+int Interface::OpenByHandle(const FileHandle& fh)
+{
+    // a file opened only by handle has no path to pick a shard with, so it's put in the one of its inode
+    const unsigned shard_idx = fh.inode_block & (NumShards - 1);
+    std::unique_lock<std::mutex> lock(opened[shard_idx].mtx);
+    std::unique_lock<std::mutex> inode_lock(inodes_mtx);
+    // removed files are held back from being opened from the moment they are unlinked until their blocks
+    // are freed, after that the block is either free or holds an inode of a different generation
+    int idx = -1;
+    if(fh.generation != 0 && !reclaimer.IsReclaiming(fh.inode_block))
+    {
+        auto it = inodes.find(fh.inode_block);
+        if(it != inodes.end())
+        {
+            idx = it->second.idx;
+            GetFCB(idx)->num_opened++;
+        }
+        else if(!bm.BlockIsFree(fh.inode_block))
+        {
+            const Inode inode = Inode::Load(bm, fh.inode_block);
+            if(inode.GetType() == ElementType::File && inode.GetGeneration() == fh.generation)
+            {
+                idx = NewSlot(shard_idx, std::string(), 
+                    Directory::LoadEntry(bm, fh.inode_block, ElementType::File), -1);
+                if(idx == -1)
+                {
+                    last_error = "too many opened files and directories";
+                    return -1;
+                }
+                inodes[fh.inode_block] = { idx, true };
+                return idx;
+            }
+        }
+    }
+    inode_lock.unlock();
+    lock.unlock();
+
+    // the opened element may be a directory or a newer file in the same block
+    if(idx != -1 && (GetType(idx) != ElementType::File || GetPtr<File>(idx)->GetGeneration(bm) != fh.generation))
+    {
+        Close(idx);
+        idx = -1;
+    }
+    if(idx == -1)
+    {
+        std::ostringstream oss;
+        oss << fh.inode_block << ":" << fh.generation << ": stale file handle";
+        last_error = oss.str();
+    }
+    return idx;
 }
 
 bool Interface::Add(const std::string& path, 
@@ -143,6 +383,33 @@ bool Interface::Add(const std::string& path,
         return false;
     }
 
+    return AddIn(idx, path, path.substr(i + 1), t, owner, perissions);
+}
+
+bool Interface::AddAt(int dir_idx, const std::string& path, 
+    ElementType t, int owner, int perissions)
+{
+    std::string filename;
+    int idx = OpenParent(dir_idx, path, filename);
+    if(idx == -1)
+    {
+        return false;
+    }
+
+    return AddIn(idx, path, filename, t, owner, perissions);
+}
+
+bool Interface::AddIn(int idx, const std::string& path, const std::string& filename, 
+    ElementType t, int owner, int perissions)
+{
+    if(!IsValidName(filename))
+    {
+        std::ostringstream oss;
+        oss << path << (filename.empty() ? ": no file or directory name entered" : ": name too long");
+        last_error = oss.str();
+        Close(idx);
+        return false;
+    }
     if(GetType(idx) != ElementType::Directory)
     {
         std::ostringstream oss;
@@ -153,18 +420,73 @@ bool Interface::Add(const std::string& path,
     }
     
     auto dir_ptr = (GetPtr<Directory>(idx));
-    std::string filename = path.substr(i + 1);
-    if(dir_ptr->EntryExists(bm, filename))
+    // the directory checks for the name under its write lock, a check out here could race with another Add
+    bool res = dir_ptr->Add(bm, filename.c_str(), t, owner, perissions);
+    dcache.Invalidate(dir_ptr->GetInodeBlock(), filename);
+    if(!res)
+    {
+        DentryCache::Dentry d;
+        std::ostringstream oss;
+        if(dir_ptr->IsRemoved())
+            oss << path << ": parent directory has been removed";
+        else
+            oss << path << (Lookup(dir_ptr, filename, d) ? ": already exists" : ": no space left");
+        last_error = oss.str();
+    }
+    Close(idx);
+    return res;
+}
+
+bool Interface::AddMany(const std::string& dir_path, const std::vector<Directory::NewEntry>& entries, 
+    int owner, std::vector<int>& results)
+{
+    int idx = Open(dir_path);
+    if(idx == -1)
+    {
+        return false;
+    }
+
+    if(GetType(idx) != ElementType::Directory)
     {
         std::ostringstream oss;
-        oss << path << ": already exists";
+        oss << GetPathString(idx) << ": not a directory";
         last_error = oss.str();
         Close(idx);
         return false;
     }
-    bool res = dir_ptr->Add(bm, filename.c_str(), t, owner, perissions);
+
+    // entries that could never be looked up or removed by path aren't created
+    std::vector<Directory::NewEntry> valid;
+    std::vector<size_t> valid_idx;
+    results.assign(entries.size(), -1);
+    for(size_t i = 0; i < entries.size(); i++)
+    {
+        if(IsValidName(entries[i].name))
+        {
+            valid.push_back(entries[i]);
+            valid_idx.push_back(i);
+        }
+    }
+
+    auto dir_ptr = GetPtr<Directory>(idx);
+    const auto added = dir_ptr->AddMany(bm, valid, owner);
+    if(std::none_of(added.begin(), added.end(), [](bool a) { return a; }) && dir_ptr->IsRemoved())
+    {
+        std::ostringstream oss;
+        oss << dir_path << ": has been removed";
+        last_error = oss.str();
+        Close(idx);
+        return false;
+    }
+    for(size_t i = 0; i < valid.size(); i++)
+    {
+        results[valid_idx[i]] = added[i] ? 1 : 0;
+        // names that didn't exist before may be cached as such
+        if(added[i])
+            dcache.Invalidate(dir_ptr->GetInodeBlock(), valid[i].name);
+    }
     Close(idx);
-    return res;
+    return true;
 }
 
 bool Interface::Remove(const std::string& path)
@@ -178,7 +500,7 @@ bool Interface::Remove(const std::string& path)
     }
 
     auto i = path.rfind('/');
-    if(i == path.size())
+    if(i == path.size() - 1)
     {
         std::ostringstream oss;
         oss << path << ": no file or directory name entered";
@@ -189,148 +511,929 @@ bool Interface::Remove(const std::string& path)
     {
         std::ostringstream oss;
         oss << path << ": invalid path";
+        last_error = oss.str();
         return false;
     }
 
-    int target_idx = Open(path);
-    if(target_idx == -1)
+    int parent_idx = Open(path.substr(0, i + 1));
+    if(parent_idx == -1)
     {
         return false;
     }
 
-    if(GetType(target_idx) == ElementType::Directory)
+    return RemoveIn(parent_idx, path, path.substr(i + 1));
+}
+
+bool Interface::RemoveAt(int dir_idx, const std::string& path)
+{
+    std::string filename;
+    int parent_idx = OpenParent(dir_idx, path, filename);
+    if(parent_idx == -1)
     {
-        std::vector<std::string> children = List(target_idx);
-        for(int i = 0; i < children.size(); i++)
-        {
-            std::string child_path = path;
-            if(child_path.back() != '/')
-                child_path += '/';
-            child_path += children[i];
-            Remove(child_path);
-        }
+        return false;
     }
-    
-    GetPtr<FSElement>(target_idx)->FreeDatablocks(bm);
-    GetPtr<FSElement>(target_idx)->FreeInodeBlock(bm);
-    Close(target_idx);
 
-    const std::string parent_path = path.substr(0, i + 1);
-    int parent_idx = Open(parent_path);
-    GetPtr<Directory>(parent_idx)->Remove(bm, path.substr(i + 1));
-    Close(parent_idx);
-    return true;
+    // the opened elements under it are found by their absolute paths
+    std::string parent_path = GetPathString(parent_idx);
+    if(parent_path.empty())
+    {
+        std::ostringstream oss;
+        oss << path << ": no such file or directroy";
+        last_error = oss.str();
+        Close(parent_idx);
+        return false;
+    }
+    if(parent_path == "/")
+        parent_path.clear();
+    return RemoveIn(parent_idx, parent_path + "/" + filename, filename);
 }
 
-std::vector<std::string> Interface::List(int idx)
+bool Interface::RemoveIn(int parent_idx, const std::string& path, const std::string& filename)
 {
-    if(GetType(idx) != ElementType::Directory)
+    if(GetType(parent_idx) != ElementType::Directory)
     {
         std::ostringstream oss;
-        oss << GetPathString(idx) << ": not a directory";
+        oss << GetPathString(parent_idx) << ": not a directory";
         last_error = oss.str();
-        return std::vector<std::string>();
+        Close(parent_idx);
+        return false;
     }
 
-    auto dir_ptr = GetPtr<Directory>(idx);
-    return dir_ptr->List(bm);
-}
-
-int Interface::Read(int idx, char* data, int offset, int data_size)
-{
-    if(GetType(idx) != ElementType::File)
+    // only what the directory erased under its write lock is reclaimed, a name looked up before that
+    // may have been removed by someone else or be taken by another element by then
+    auto parent_ptr = GetPtr<Directory>(parent_idx);
+    unsigned int block_num;
+    ElementType type;
+    const bool removed = parent_ptr->Remove(bm, filename, block_num, type);
+    dcache.Invalidate(parent_ptr->GetInodeBlock(), filename);
+    Close(parent_idx);
+    if(!removed)
     {
         std::ostringstream oss;
-        oss << GetPathString(idx) << ": not a file\n";
+        oss << path << ": no such file or directroy";
         last_error = oss.str();
-        return -1;
+        return false;
     }
-    
-    auto file_ptr = GetPtr<File>(idx);
-    return file_ptr->Read(bm, data, offset, data_size);
+
+    // once the entry is gone nothing new can reach the element, so the rest doesn't have to hold up the caller
+    DetachOpened(path, block_num);
+    reclaimer.Reclaim(block_num, type);
+    return true;
 }
 
-int Interface::Write(int idx, const char* data, int offset, int data_size)
+int Interface::OpenParent(int dir_idx, const std::string& path, std::string& name)
 {
-    if(GetType(idx) != ElementType::File)
+    auto i = path.rfind('/');
+    name = i == std::string::npos ? path : path.substr(i + 1);
+    if(name.empty())
     {
         std::ostringstream oss;
-        oss << GetPathString(idx) << ": not a file\n";
+        oss << path << ": no file or directory name entered";
         last_error = oss.str();
         return -1;
     }
-    
-    auto file_ptr = GetPtr<File>(idx);
-    return file_ptr->Write(bm, data, offset, data_size);
+    return OpenAt(dir_idx, i == std::string::npos ? std::string() : path.substr(0, i + 1));
 }
 
-std::string Interface::GetPathString(int idx) const
+bool Interface::Clone(const std::string& src_path, const std::string& dst_path, int owner)
 {
-    mtx.lock();
-    auto path_str = opened[idx].path_str;
-    mtx.unlock();
-    return path_str;
-}
+    auto i = dst_path.rfind('/');
+    if(i == dst_path.size() - 1)
+    {
+        std::ostringstream oss;
+        oss << dst_path << ": no file or directory name entered";
+        last_error = oss.str();
+        return false;
+    }
+    else if(i == std::string::npos)
+    {
+        std::ostringstream oss;
+        oss << dst_path << ": invalid path";
+        last_error = oss.str();
+        return false;
+    }
 
-FS::ElementType Interface::GetType(int idx) const
-{
-    mtx.lock();
-    auto e = opened[idx].ptr->GetType();
-    mtx.unlock();
-    return e;
-}
+    int src_idx = Open(src_path);
+    if(src_idx == -1)
+    {
+        return false;
+    }
 
-void Interface::AddFSElement(const std::string& path, FSElementPtr&& ptr_in, int num_opened)
-{
-    mtx.lock();
-    opened.emplace_back(path, std::move(ptr_in), num_opened);
-    mtx.unlock();
-}
+    if(GetType(src_idx) != ElementType::File)
+    {
+        std::ostringstream oss;
+        oss << src_path << ": not a file";
+        last_error = oss.str();
+        Close(src_idx);
+        return false;
+    }
+
+    int idx = Open(dst_path.substr(0, i + 1));
+    if(idx == -1)
+    {
+        Close(src_idx);
+        return false;
+    }
+
+    if(GetType(idx) != ElementType::Directory)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": not a directory";
+        last_error = oss.str();
+        Close(idx);
+        Close(src_idx);
+        return false;
+    }
+
+    auto dir_ptr = GetPtr<Directory>(idx);
+    std::string filename = dst_path.substr(i + 1);
+    // delayed writes have to be on disk for the clone to share them
+    auto src_ptr = GetPtr<File>(src_idx);
+    src_ptr->Sync(bm);
+    // as with Add, the name is only checked under the directory's write lock
+    bool res = dir_ptr->Clone(bm, filename.c_str(), *src_ptr, owner);
+    dcache.Invalidate(dir_ptr->GetInodeBlock(), filename);
+    if(!res)
+    {
+        DentryCache::Dentry d;
+        std::ostringstream oss;
+        if(src_ptr->IsRemoved())
+            oss << src_path << ": has been removed";
+        else if(dir_ptr->IsRemoved())
+            oss << dst_path << ": parent directory has been removed";
+        else
+            oss << dst_path << (Lookup(dir_ptr, filename, d) ? ": already exists" : ": no space left");
+        last_error = oss.str();
+    }
+    Close(idx);
+    Close(src_idx);
+    return res;
+}
 
-int Interface::GetNumFSElements() const
+bool Interface::Rename(const std::string& old_path, const std::string& new_path)
 {
-    mtx.lock();
-    int s = opened.size();
-    mtx.unlock();
-    return s;
+    if(old_path == "/")
+    {
+        std::ostringstream oss;
+        oss << "attempting to move root";
+        last_error = oss.str();
+        return false;
+    }
+
+    for(const auto& path : { old_path, new_path })
+    {
+        auto i = path.rfind('/');
+        if(i == std::string::npos)
+        {
+            std::ostringstream oss;
+            oss << path << ": invalid path";
+            last_error = oss.str();
+            return false;
+        }
+        else if(i == path.size() - 1)
+        {
+            std::ostringstream oss;
+            oss << path << ": no file or directory name entered";
+            last_error = oss.str();
+            return false;
+        }
+    }
+    const auto old_i = old_path.rfind('/');
+    const auto new_i = new_path.rfind('/');
+    const std::string old_parent = old_path.substr(0, old_i + 1);
+    const std::string new_parent = new_path.substr(0, new_i + 1);
+    const std::string old_name = old_path.substr(old_i + 1);
+    const std::string new_name = new_path.substr(new_i + 1);
+    if(!IsValidName(new_name))
+    {
+        std::ostringstream oss;
+        oss << new_path << ": name too long";
+        last_error = oss.str();
+        return false;
+    }
+
+    // moving between directories is serialized, otherwise moving a into b/ while b is moved into a/ 
+    // could pass the check below for both and leave them unreachable
+    std::unique_lock<std::mutex> rename_lock(rename_mtx, std::defer_lock);
+    if(old_parent != new_parent)
+        rename_lock.lock();
+
+    // compared by whole components, so /a may still be moved into /ab
+    const auto old_split = SplitPath(old_path);
+    const auto new_split = SplitPath(new_path);
+    if(new_split.size() > old_split.size() && std::equal(old_split.begin(), old_split.end(), new_split.begin()))
+    {
+        std::ostringstream oss;
+        oss << new_path << ": can't move a directory into itself";
+        last_error = oss.str();
+        return false;
+    }
+
+    int old_idx = Open(old_parent);
+    if(old_idx == -1)
+    {
+        return false;
+    }
+    int new_idx = Open(new_parent);
+    if(new_idx == -1)
+    {
+        Close(old_idx);
+        return false;
+    }
+
+    for(int idx : { old_idx, new_idx })
+    {
+        if(GetType(idx) != ElementType::Directory)
+        {
+            std::ostringstream oss;
+            oss << GetPathString(idx) << ": not a directory";
+            last_error = oss.str();
+            Close(new_idx);
+            Close(old_idx);
+            return false;
+        }
+    }
+
+    auto old_dir_ptr = GetPtr<Directory>(old_idx);
+    auto new_dir_ptr = GetPtr<Directory>(new_idx);
+    DentryCache::Dentry d;
+    bool res = false;
+    if(!Lookup(old_dir_ptr, old_name, d))
+    {
+        std::ostringstream oss;
+        oss << old_path << ": no such file or directroy";
+        last_error = oss.str();
+    }
+    else if(Lookup(new_dir_ptr, new_name, d))
+    {
+        std::ostringstream oss;
+        oss << new_path << ": already exists";
+        last_error = oss.str();
+    }
+    else if(!(res = Directory::Move(bm, *old_dir_ptr, old_name, *new_dir_ptr, new_name)))
+    {
+        std::ostringstream oss;
+        oss << old_path << ": could not be moved to " << new_path;
+        last_error = oss.str();
+    }
+    else
+    {
+        // a moved directory keeps its inode block, so only the two names are stale
+        dcache.Invalidate(old_dir_ptr->GetInodeBlock(), old_name);
+        dcache.Invalidate(new_dir_ptr->GetInodeBlock(), new_name);
+        RenameOpened(old_path, new_path);
+    }
+
+    Close(new_idx);
+    Close(old_idx);
+    return res;
 }
 
-void Interface::IncrementNumOpened(int idx)
+std::vector<std::string> Interface::List(int idx)
 {
-    mtx.lock();
-    opened[idx].num_opened++;
-    mtx.unlock();
+    if(!IsOpened(idx))
+    {
+        std::ostringstream oss;
+        oss << idx << ": bad handle";
+        last_error = oss.str();
+        return std::vector<std::string>();
+    }
+    if(GetType(idx) != ElementType::Directory)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": not a directory";
+        last_error = oss.str();
+        return std::vector<std::string>();
+    }
+
+    auto dir_ptr = GetPtr<Directory>(idx);
+    return dir_ptr->List(bm);
 }
 
-void Interface::DecrementNumOpened(int idx)
+std::vector<Directory::EntryInfo> Interface::ListPlus(int idx)
 {
-    mtx.lock();
-    opened[idx].num_opened++;
-    mtx.unlock();
+    if(!IsOpened(idx))
+    {
+        std::ostringstream oss;
+        oss << idx << ": bad handle";
+        last_error = oss.str();
+        return std::vector<Directory::EntryInfo>();
+    }
+    if(GetType(idx) != ElementType::Directory)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": not a directory";
+        last_error = oss.str();
+        return std::vector<Directory::EntryInfo>();
+    }
+
+    auto dir_ptr = GetPtr<Directory>(idx);
+    auto entries = dir_ptr->ListPlus(bm);
+    OverlayOpened(entries);
+    return entries;
 }
 
-void Interface::ClearOpened()
+long long Interface::ListPage(int idx, long long cookie, 
+    const std::function<bool(const std::string&)>& fits, std::vector<Directory::EntryInfo>& page)
 {
-    mtx.lock();
-    opened.erase(
-        std::remove_if(opened.begin(), opened.end(), 
-            [](const MasterFCB& e){ return e.num_opened == 0; }
-        ), 
-        opened.end()
-    );
-    mtx.unlock();
+    if(!IsOpened(idx))
+    {
+        std::ostringstream oss;
+        oss << idx << ": bad handle";
+        last_error = oss.str();
+        return -1;
+    }
+    if(GetType(idx) != ElementType::Directory)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": not a directory";
+        last_error = oss.str();
+        return -1;
+    }
+
+    auto dir_ptr = GetPtr<Directory>(idx);
+    const long long next = dir_ptr->ListPage(bm, cookie, fits, page);
+    if(next == -2)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": directory was compacted, the listing has to start over";
+        last_error = oss.str();
+    }
+    else
+    {
+        OverlayOpened(page);
+    }
+    return next;
 }
 
-int Interface::GetIdx(const std::string& path)
+std::vector<std::string> Interface::List(int idx, const std::string& resume_after, 
+    unsigned int max_entries, const std::string& prefix)
 {
-    mtx.lock();
-    auto it = std::find_if(
-        opened.begin(), opened.end(), [&path](const MasterFCB& e){ return e.path_str == path; }
-    );
-    int res = std::distance(opened.begin(), it);
-    mtx.unlock();
+    if(!IsOpened(idx))
+    {
+        std::ostringstream oss;
+        oss << idx << ": bad handle";
+        last_error = oss.str();
+        return std::vector<std::string>();
+    }
+    if(GetType(idx) != ElementType::Directory)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": not a directory";
+        last_error = oss.str();
+        return std::vector<std::string>();
+    }
 
-    return res;
+    auto dir_ptr = GetPtr<Directory>(idx);
+    return dir_ptr->List(bm, resume_after, max_entries, prefix);
+}
+
+int Interface::Read(int idx, char* data, int offset, int data_size)
+{
+    if(!IsOpened(idx))
+    {
+        std::ostringstream oss;
+        oss << idx << ": bad handle";
+        last_error = oss.str();
+        return -1;
+    }
+    if(GetType(idx) != ElementType::File)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": not a file\n";
+        last_error = oss.str();
+        return -1;
+    }
+    
+    auto file_ptr = GetPtr<File>(idx);
+    return file_ptr->Read(bm, data, offset, data_size);
+}
+
+int Interface::Write(int idx, const char* data, int offset, int data_size)
+{
+    if(!IsOpened(idx))
+    {
+        std::ostringstream oss;
+        oss << idx << ": bad handle";
+        last_error = oss.str();
+        return -1;
+    }
+    if(GetType(idx) != ElementType::File)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": not a file\n";
+        last_error = oss.str();
+        return -1;
+    }
+    
+    auto file_ptr = GetPtr<File>(idx);
+    int num = file_ptr->Write(bm, data, offset, data_size);
+    if(num == -1)
+    {
+        std::ostringstream oss;
+        // a removed file has no path anymore
+        oss << idx << ": has been removed";
+        last_error = oss.str();
+    }
+    return num;
+}
+
+int Interface::Append(int idx, const char* data, int data_size)
+{
+    if(!IsOpened(idx))
+    {
+        std::ostringstream oss;
+        oss << idx << ": bad handle";
+        last_error = oss.str();
+        return -1;
+    }
+    if(GetType(idx) != ElementType::File)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": not a file\n";
+        last_error = oss.str();
+        return -1;
+    }
+
+    auto file_ptr = GetPtr<File>(idx);
+    int offset = file_ptr->Append(bm, data, data_size);
+    if(offset == -1)
+    {
+        std::ostringstream oss;
+        if(file_ptr->IsRemoved())
+            oss << idx << ": has been removed";
+        else
+            oss << GetPathString(idx) << ": no space left\n";
+        last_error = oss.str();
+    }
+    return offset;
+}
+
+int Interface::SeekData(int idx, int offset)
+{
+    if(!IsOpened(idx))
+    {
+        std::ostringstream oss;
+        oss << idx << ": bad handle";
+        last_error = oss.str();
+        return -1;
+    }
+    if(GetType(idx) != ElementType::File)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": not a file\n";
+        last_error = oss.str();
+        return -1;
+    }
+    if(offset < 0)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": invalid offset\n";
+        last_error = oss.str();
+        return -1;
+    }
+
+    auto file_ptr = GetPtr<File>(idx);
+    return file_ptr->SeekData(bm, offset);
+}
+
+int Interface::SeekHole(int idx, int offset)
+{
+    if(!IsOpened(idx))
+    {
+        std::ostringstream oss;
+        oss << idx << ": bad handle";
+        last_error = oss.str();
+        return -1;
+    }
+    if(GetType(idx) != ElementType::File)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": not a file\n";
+        last_error = oss.str();
+        return -1;
+    }
+    if(offset < 0)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": invalid offset\n";
+        last_error = oss.str();
+        return -1;
+    }
+
+    auto file_ptr = GetPtr<File>(idx);
+    return file_ptr->SeekHole(bm, offset);
+}
+
+bool Interface::Truncate(int idx, int size)
+{
+    if(!IsOpened(idx))
+    {
+        std::ostringstream oss;
+        oss << idx << ": bad handle";
+        last_error = oss.str();
+        return false;
+    }
+    if(GetType(idx) != ElementType::File)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": not a file\n";
+        last_error = oss.str();
+        return false;
+    }
+    if(size < 0)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": invalid size\n";
+        last_error = oss.str();
+        return false;
+    }
+
+    auto file_ptr = GetPtr<File>(idx);
+    if(!file_ptr->Truncate(bm, size))
+    {
+        std::ostringstream oss;
+        if(file_ptr->IsRemoved())
+            oss << idx << ": has been removed";
+        else
+            oss << GetPathString(idx) << ": file too large\n";
+        last_error = oss.str();
+        return false;
+    }
+    return true;
+}
+
+bool Interface::Preallocate(int idx, int offset, int size)
+{
+    if(!IsOpened(idx))
+    {
+        std::ostringstream oss;
+        oss << idx << ": bad handle";
+        last_error = oss.str();
+        return false;
+    }
+    if(GetType(idx) != ElementType::File)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": not a file\n";
+        last_error = oss.str();
+        return false;
+    }
+    if(offset < 0 || size < 0)
+    {
+        std::ostringstream oss;
+        oss << GetPathString(idx) << ": invalid range\n";
+        last_error = oss.str();
+        return false;
+    }
+
+    auto file_ptr = GetPtr<File>(idx);
+    if(!file_ptr->Preallocate(bm, offset, size))
+    {
+        std::ostringstream oss;
+        if(file_ptr->IsRemoved())
+            oss << idx << ": has been removed";
+        else
+            oss << GetPathString(idx) << ": no space left\n";
+        last_error = oss.str();
+        return false;
+    }
+    return true;
+}
+
+bool Interface::IsOpened(int idx) const
+{
+    return GetFCB(idx) != nullptr;
+}
+
+std::string Interface::GetPathString(int idx) const
+{
+    auto fcb = GetFCB(idx);
+    if(fcb == nullptr)
+        return std::string();
+    // paths are only changed with every shard locked
+    std::unique_lock<std::mutex> lock(opened[(idx >> SlotBits) & (NumShards - 1)].mtx);
+    return fcb->path_str;
+}
+
+FS::ElementType Interface::GetType(int idx) const
+{
+    auto fcb = GetFCB(idx);
+    // a stale handle is nothing that can be read or listed
+    return fcb ? fcb->ptr->GetType() : ElementType::Index;
+}
+
+unsigned int Interface::GetSize(int idx) const
+{
+    auto fcb = GetFCB(idx);
+    return fcb ? fcb->ptr->GetSize() : 0;
+}
+
+Interface::Shard::Shard()
+{
+    for(auto& c : chunks)
+        c.store(nullptr);
+}
+
+Interface::Shard::~Shard()
+{
+    for(auto& c : chunks)
+        delete[] c.load();
+}
+
+Interface::Slot* Interface::Shard::At(unsigned slot) const
+{
+    Slot* chunk = chunks[slot / ChunkSize].load(std::memory_order_acquire);
+    return chunk ? &chunk[slot % ChunkSize] : nullptr;
+}
+
+Interface::MasterFCB* Interface::GetFCB(int idx) const
+{
+    if(idx < 0)
+        return nullptr;
+    const unsigned slot = idx & (ShardSize - 1);
+    const unsigned shard_idx = (idx >> SlotBits) & (NumShards - 1);
+    const unsigned generation = (unsigned)idx >> (SlotBits + ShardBits);
+    Slot* s = opened[shard_idx].At(slot);
+    if(s == nullptr || !s->used.load(std::memory_order_acquire) || s->generation.load() != generation)
+        return nullptr;
+    return &s->fcb;
+}
+
+unsigned Interface::GetShardIdx(const std::string& path)
+{
+    return std::hash<std::string>()(path) & (NumShards - 1);
+}
+
+int Interface::AddFSElement(const std::string& path, FSElementPtr&& ptr_in, int parent, 
+    unsigned long dropped, unsigned long reclaimed)
+{
+    const unsigned shard_idx = GetShardIdx(path);
+    auto& shard = opened[shard_idx];
+    std::unique_lock<std::mutex> lock(shard.mtx);
+    auto it = shard.paths.find(path);
+    if(it != shard.paths.end())
+    {
+        // lost the race to open it, the other copy is the one in use
+        const int idx = it->second;
+        GetFCB(idx)->num_opened++;
+        lock.unlock();
+        Release(parent);
+        return idx;
+    }
+    std::unique_lock<std::mutex> inode_lock(inodes_mtx);
+    auto inode_it = inodes.find(ptr_in->GetInodeBlock());
+    if(inode_it != inodes.end())
+    {
+        // already opened by handle or by the path it had before a rename that hasn't reached the opened table yet,
+        // that copy holds the current state of the element and a second one would be written back over it
+        const int idx = inode_it->second.idx;
+        GetFCB(idx)->num_opened++;
+        inode_lock.unlock();
+        lock.unlock();
+        Release(parent);
+        return idx;
+    }
+
+    // it may have been removed after it was loaded, the reclaimer detaches it once it's indexed
+    // (it needs inodes_mtx for that) but if the blocks were freed before then, they aren't the element's anymore
+    const unsigned int block_num = ptr_in->GetInodeBlock();
+    if(reclaimer.IsReclaiming(block_num) || (reclaimer.GetNumReclaimed() != reclaimed && 
+        (bm.BlockIsFree(block_num) || Inode::Load(bm, block_num).GetGeneration() != ptr_in->GetGeneration(bm))))
+        return -2;
+
+    // the copy that was opened while this one was loaded may have been written back and dropped since
+    if(num_dropped.load() != dropped)
+        ptr_in = Directory::LoadEntry(bm, ptr_in->GetInodeBlock(), ptr_in->GetType());
+
+    const int idx = NewSlot(shard_idx, path, std::move(ptr_in), parent);
+    if(idx != -1)
+    {
+        shard.paths.emplace(path, idx);
+        inodes[GetFCB(idx)->ptr->GetInodeBlock()] = { idx, false };
+    }
+    return idx;
+}
+
+int Interface::NewSlot(unsigned shard_idx, const std::string& path, FSElementPtr&& ptr_in, int parent)
+{
+    auto& shard = opened[shard_idx];
+    unsigned slot;
+    if(!shard.free_slots.empty())
+    {
+        slot = shard.free_slots.back();
+        shard.free_slots.pop_back();
+    }
+    else if(shard.num_slots < ShardSize)
+    {
+        slot = shard.num_slots++;
+        if(slot % ChunkSize == 0)
+            shard.chunks[slot / ChunkSize].store(new Slot[ChunkSize], std::memory_order_release);
+    }
+    else
+    {
+        return -1;
+    }
+
+    Slot* s = shard.At(slot);
+    s->fcb.path_str = path;
+    s->fcb.ptr = std::move(ptr_in);
+    s->fcb.num_opened = 1;
+    s->fcb.parent = parent;
+    s->used.store(true, std::memory_order_release);
+    return (int)(s->generation.load() << (SlotBits + ShardBits) | shard_idx << SlotBits | slot);
+}
+
+int Interface::Acquire(const std::string& path)
+{
+    auto& shard = opened[GetShardIdx(path)];
+    std::unique_lock<std::mutex> lock(shard.mtx);
+    auto it = shard.paths.find(path);
+    if(it == shard.paths.end())
+        return -1;
+    // counted while indexed, so a concurrent release that hit 0 sees it and keeps the slot
+    GetFCB(it->second)->num_opened++;
+    return it->second;
+}
+
+void Interface::Retain(int idx)
+{
+    // root isn't counted
+    if(idx > 0)
+        GetFCB(idx)->num_opened++;
+}
+
+void Interface::Release(int idx)
+{
+    // root is never dropped
+    while(idx > 0)
+    {
+        const unsigned slot = idx & (ShardSize - 1);
+        const unsigned shard_idx = (idx >> SlotBits) & (NumShards - 1);
+        auto& shard = opened[shard_idx];
+        Slot* s = shard.At(slot);
+        if(s->fcb.num_opened.fetch_sub(1) > 1)
+            return;
+
+        // the slot is freed with the shard it's in and the shard it's indexed in locked,
+        // it may have been opened again through the index before either was taken
+        const unsigned generation = s->generation.load();
+        std::unique_lock<std::mutex> slot_lock(shard.mtx, std::defer_lock);
+        std::unique_lock<std::mutex> path_lock;
+        while(true)
+        {
+            slot_lock.lock();
+            if(s->fcb.num_opened != 0 || !s->used || s->generation != generation)
+                return;
+            const unsigned path_shard_idx = s->fcb.path_str.empty() ? 
+                shard_idx : GetShardIdx(s->fcb.path_str);
+            if(path_shard_idx == shard_idx)
+                break;
+            // take both in a deadlock free order, the path can change while neither is held
+            slot_lock.unlock();
+            path_lock = std::unique_lock<std::mutex>(opened[path_shard_idx].mtx, std::defer_lock);
+            std::lock(slot_lock, path_lock);
+            if(s->fcb.num_opened != 0 || !s->used || s->generation != generation)
+                return;
+            if(GetShardIdx(s->fcb.path_str) == path_shard_idx)
+                break;
+            slot_lock.unlock();
+            path_lock.unlock();
+        }
+
+        // elements that are no longer opened are dropped from memory, write back what they are holding
+        s->fcb.ptr->Sync(bm);
+        {
+            // it may have been opened again by handle, which goes by the inode instead of the locks held here
+            // taken out of the index only once it's written back, so the next open loads what was written
+            std::unique_lock<std::mutex> inode_lock(inodes_mtx);
+            if(s->fcb.num_opened != 0)
+                return;
+            auto it = inodes.find(s->fcb.ptr->GetInodeBlock());
+            if(it != inodes.end() && it->second.idx == idx)
+            {
+                inodes.erase(it);
+                num_dropped++;
+            }
+        }
+        if(!s->fcb.path_str.empty())
+        {
+            auto& paths = opened[GetShardIdx(s->fcb.path_str)].paths;
+            auto it = paths.find(s->fcb.path_str);
+            if(it != paths.end() && it->second == idx)
+                paths.erase(it);
+        }
+        idx = s->fcb.parent;
+        s->used.store(false);
+        s->generation.store((generation + 1) & GenerationMask);
+        s->fcb.ptr.reset();
+        s->fcb.path_str.clear();
+        shard.free_slots.push_back(slot);
+    }
+}
+
+std::vector<std::unique_lock<std::mutex>> Interface::LockOpened()
+{
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for(auto& shard : opened)
+        locks.emplace_back(shard.mtx);
+    return locks;
+}
+
+void Interface::RenameOpened(const std::string& old_path, const std::string& new_path)
+{
+    auto locks = LockOpened();
+    for(unsigned shard_idx = 0; shard_idx < NumShards; shard_idx++)
+    {
+        auto& shard = opened[shard_idx];
+        for(unsigned slot = 0; slot < shard.num_slots; slot++)
+        {
+            Slot* s = shard.At(slot);
+            auto& e = s->fcb;
+            if(!s->used || e.path_str.empty())
+                continue;
+            std::string path_str;
+            if(e.path_str == old_path)
+                path_str = new_path;
+            else if(e.path_str.compare(0, old_path.size() + 1, old_path + "/") == 0)
+                path_str = new_path + e.path_str.substr(old_path.size());
+            else
+                continue;
+            const int idx = (int)(s->generation << (SlotBits + ShardBits) | shard_idx << SlotBits | slot);
+            opened[GetShardIdx(e.path_str)].paths.erase(e.path_str);
+            e.path_str = std::move(path_str);
+            opened[GetShardIdx(e.path_str)].paths[e.path_str] = idx;
+        }
+    }
+}
+
+void Interface::DetachOpened(const std::string& path, unsigned int block_num)
+{
+    auto locks = LockOpened();
+    for(unsigned shard_idx = 0; shard_idx < NumShards; shard_idx++)
+    {
+        auto& shard = opened[shard_idx];
+        for(unsigned slot = 0; slot < shard.num_slots; slot++)
+        {
+            Slot* s = shard.At(slot);
+            auto& e = s->fcb;
+            if(!s->used || e.path_str.empty())
+                continue;
+            if(e.path_str != path && e.path_str.compare(0, path.size() + 1, path + "/") != 0)
+                continue;
+            // the removed element is the element itself or one of the parents it was opened through
+            bool under_removed = false;
+            for(const MasterFCB* fcb = &e; fcb != nullptr && !under_removed; 
+                fcb = fcb->parent > 0 ? GetFCB(fcb->parent) : nullptr)
+                under_removed = fcb->ptr->GetInodeBlock() == block_num;
+            if(!under_removed)
+                continue;
+
+            e.ptr->Detach(bm);
+            // taken out of the index, so a new element at the same path is loaded fresh
+            const int idx = (int)(s->generation << (SlotBits + ShardBits) | shard_idx << SlotBits | slot);
+            auto& paths = opened[GetShardIdx(e.path_str)].paths;
+            auto it = paths.find(e.path_str);
+            if(it != paths.end() && it->second == idx)
+                paths.erase(it);
+            e.path_str.clear();
+        }
+    }
+}
+
+void Interface::DetachInode(unsigned int block_num)
+{
+    std::unique_lock<std::mutex> lock(inodes_mtx);
+    auto it = inodes.find(block_num);
+    if(it == inodes.end())
+        return;
+    // an indexed element isn't freed before it's taken out of the index
+    GetFCB(it->second.idx)->ptr->Detach(bm);
+    inodes.erase(it);
+}
+
+bool Interface::Lookup(const Directory* dir, const std::string& name, DentryCache::Dentry& d)
+{
+    unsigned long generation;
+    if(!dcache.Lookup(dir->GetInodeBlock(), name, d, generation))
+    {
+        // misses are cached as well, so repeated checks for a name that doesn't exist stay in memory
+        dir->Lookup(bm, name, d.block_num, d.type, d.unlink_stamp);
+        dcache.Insert(dir->GetInodeBlock(), name, d, generation);
+    }
+    return d.block_num != 0;
+}
+
+void Interface::OverlayOpened(std::vector<Directory::EntryInfo>& entries)
+{
+    // elements are taken out of the index before they are freed, so the ones found stay loaded while it's locked
+    std::unique_lock<std::mutex> lock(inodes_mtx);
+    for(auto& e : entries)
+    {
+        auto it = inodes.find(e.block_num);
+        if(it != inodes.end())
+            e.metadata = GetFCB(it->second.idx)->ptr->GetMetadata();
+    }
 }
 
 std::string Interface::GetLastError() const
@@ -348,6 +1451,38 @@ int Interface::GetNumFreeBlocks() const
     return bm.GetNumFreeBlocks();
 }
 
+void Interface::Sync()
+{
+    reclaimer.Wait();
+    for(auto& shard : opened)
+    {
+        std::unique_lock<std::mutex> lock(shard.mtx);
+        for(unsigned slot = 0; slot < shard.num_slots; slot++)
+        {
+            Slot* s = shard.At(slot);
+            if(s->used)
+                s->fcb.ptr->Sync(bm);
+        }
+    }
+}
+
+void Interface::SyncLoop()
+{
+    const auto interval = std::chrono::seconds(bm.GetMountOptions().sync_interval);
+    std::unique_lock<std::mutex> lock(sync_mtx);
+    while(!sync_cv.wait_for(lock, interval, [this](){ return !mounted; }))
+    {
+        lock.unlock();
+        Sync();
+        lock.lock();
+    }
+}
+
+bool Interface::IsValidName(const std::string& name)
+{
+    return !name.empty() && name.size() <= (size_t)MaxNameLen && name.find('/') == std::string::npos;
+}
+
 std::vector<std::string> Interface::SplitPath(const std::string& path_str)
 {
     std::vector<std::string> split_path;
@@ -3,25 +3,39 @@
 #include <Disk.h>
 #include <BlockManager.h>
 #include <Directory.h>
+#include <DentryCache.h>
+#include <Reclaimer.h>
 #include <semaphore.h>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <atomic>
+#include <array>
 
 namespace FS
 {
     class Interface
     {
+        // max number of names kept in the dentry cache
+        static constexpr size_t DentryCacheSize = 4096;
+        // a handle is the slot in the opened table in the low bits, then the shard it's in and the slot's 
+        // generation above it, so a handle to a slot that has been closed and reused is rejected 
+        // instead of reaching another element
+        static constexpr int SlotBits = 12;
+        static constexpr int ShardBits = 4;
+        static constexpr unsigned NumShards = 1u << ShardBits;
+        static constexpr unsigned ShardSize = 1u << SlotBits;
+        static constexpr unsigned ChunkSize = 256;
+        static constexpr unsigned GenerationMask = 0x7FFF;
         struct MasterFCB
         {
             std::string path_str;
             FS::FSElementPtr ptr;
-            int num_opened;
+            // opens of this element plus the opened elements under it (each one holds its parent)
+            std::atomic<int> num_opened{ 0 };
+            // handle of the directory this was opened through, -1 for root
+            int parent = -1;
             //std::mutex mtx;
-
-            MasterFCB(const std::string& path, FS::FSElementPtr&& ptr_in, int num_opened = 1)
-                :
-                path_str(path),
-                ptr(std::move(ptr_in)),
-                num_opened(num_opened)
-            {}
             //MasterFCB(MasterFCB&& rhs)
             //{
             //    //sem_wait(&s);
@@ -41,33 +55,121 @@ namespace FS
             //    return *this;
             //}
         };
+        struct Slot
+        {
+            MasterFCB fcb;
+            std::atomic<unsigned> generation{ 0 };
+            std::atomic<bool> used{ false };
+        };
+        // the opened elements whose path hashes to the shard are allocated from it and indexed in it
+        // (renamed elements keep their slot but are indexed under the shard of their new path)
+        struct Shard
+        {
+            mutable std::mutex mtx;
+            // allocated a chunk at a time and never moved, so handles are resolved without the lock
+            std::array<std::atomic<Slot*>, ShardSize / ChunkSize> chunks;
+            unsigned num_slots = 0;
+            std::vector<unsigned> free_slots;
+            // handle of the element opened at each path, detached elements aren't in it
+            std::unordered_map<std::string, int> paths;
+
+            Shard();
+            ~Shard();
+            Slot* At(unsigned slot) const;
+        };
+        struct OpenedInode
+        {
+            int idx;
+            // opened by handle only, so it has no path
+            bool by_handle;
+        };
     public:
-        Interface(const std::string& disk_filename);
+        // names a file by its inode instead of a path, the generation tells it apart from
+        // whatever is created in the same block after it's removed
+        struct FileHandle
+        {
+            unsigned int inode_block;
+            unsigned int generation;
+        };
+    public:
+        Interface(const std::string& disk_filename, 
+            const MountOptions& opts = {});
         Interface(const Interface&) = delete;
         Interface& operator=(const Interface&) = delete;
-        ~Interface() = default;
+        // stops the sync thread and writes back anything still held in memory
+        ~Interface();
 
         // general functions
         int Open(const std::string& path);
         int Open(const std::vector<std::string>& split_path);
+        // open path relative to the opened directory dir_idx, only the components after it are walked
+        // an absolute path is opened from root
+        int OpenAt(int dir_idx, const std::string& path);
         void Close(int idx);
+        // metadata of the element at path, kept in memory if it's opened and read from its inode otherwise
+        // neither reads any data blocks
+        bool Stat(const std::string& path, Inode::Metadata& mtd);
+        bool Fstat(int idx, Inode::Metadata& mtd);
+        // get a handle to the opened file idx that stays valid across renames
+        // fails for directories and removed files
+        bool GetFileHandle(int idx, FileHandle& fh);
+        // open the file fh names without resolving any path, fails if it has been removed since
+        // a file opened only this way has no path
+        int OpenByHandle(const FileHandle& fh);
 
         // directory functions
         bool Add(const std::string& path, 
             ElementType t, int owner, int perissions);
+        // Add/Remove with path relative to the opened directory dir_idx (see OpenAt)
+        bool AddAt(int dir_idx, const std::string& path, 
+            ElementType t, int owner, int perissions);
+        // create a batch of elements in the directory at dir_path with a single lookup of the directory
+        // results[i] is set to 1 if entries[i] was created, 0 if it exists or there was no room for it
+        // and -1 if its name can't be used (see IsValidName), returns false if the directory can't be opened
+        bool AddMany(const std::string& dir_path, const std::vector<Directory::NewEntry>& entries, 
+            int owner, std::vector<int>& results);
+        // the element is unlinked right away, its blocks (and everything under it) are freed in the background
         bool Remove(const std::string& path);
+        bool RemoveAt(int dir_idx, const std::string& path);
+        bool Clone(const std::string& src_path, const std::string& dst_path, int owner);
+        // move the file or directory at old_path to new_path, only the directory entries are changed
+        // fails if new_path already exists
+        bool Rename(const std::string& old_path, const std::string& new_path);
         std::vector<std::string> List(int idx);
+        // list every entry with its metadata in one pass
+        std::vector<Directory::EntryInfo> ListPlus(int idx);
+        // list the entries with their metadata a page at a time (see Directory::ListPage)
+        // returns -1 if idx isn't an opened directory
+        long long ListPage(int idx, long long cookie, 
+            const std::function<bool(const std::string&)>& fits, std::vector<Directory::EntryInfo>& page);
+        // list up to max_entries names in sorted order, resuming after the given name
+        std::vector<std::string> List(int idx, const std::string& resume_after, 
+            unsigned int max_entries, const std::string& prefix = "");
 
         // file functions
         int Read(int idx, char* data, int offset, int data_size);
         int Write(int idx, const char* data, int offset, int data_size);
+        // write all of data at the end of the file, returns the offset it went to or -1
+        int Append(int idx, const char* data, int data_size);
+        int SeekData(int idx, int offset);
+        int SeekHole(int idx, int offset);
+        bool Truncate(int idx, int size);
+        bool Preallocate(int idx, int offset, int size);
 
+        // the error of the last failed call made from this thread
         std::string GetLastError() const;
+        // false if idx isn't a handle returned by Open or it has been closed since
+        bool IsOpened(int idx) const;
         std::string GetPathString(int idx) const;
         FS::ElementType GetType(int idx) const;
+        unsigned int GetSize(int idx) const;
         
         int GetFreeSpace() const;
         int GetNumFreeBlocks() const;
+
+        // write back inode changes kept in memory by every opened element
+        // waits for removed elements to be freed first
+        void Sync();
     
     private:
         /* Thread safe accessors from opened file data */
@@ -75,27 +177,90 @@ namespace FS
         template<typename FSElementType> 
         FSElementType* GetPtr(int idx)
         {
-            mtx.lock();
-            auto ptr = (FSElementType*)opened[idx].ptr.get();
-            mtx.unlock();
-            return ptr;
+            auto fcb = GetFCB(idx);
+            return fcb ? (FSElementType*)fcb->ptr.get() : nullptr;
         }
-        void AddFSElement(const std::string& path, FSElementPtr&& ptr_in, int num_opened = 1);
-        int GetNumFSElements() const;
-        void IncrementNumOpened(int idx);
-        void DecrementNumOpened(int idx);
-        void ClearOpened();
+        // the entry idx refers to or nullptr if it's stale, doesn't lock
+        // the entry stays valid for as long as the caller holds the handle
+        MasterFCB* GetFCB(int idx) const;
+        static unsigned GetShardIdx(const std::string& path);
+        // put a newly loaded element in a free slot, it takes over the caller's reference to parent
+        // if another thread opened the same path or inode in the meantime that one is used instead
+        // num_dropped is what it was before the element was loaded, if a copy was written back and dropped
+        // since, the element is loaded again
+        // reclaimed is the reclaimer's count from before the element was loaded, to tell if its blocks may have
+        // been freed since without the reclaimer finding it opened
+        // returns -1 if there is no free slot or -2 if the element was removed and freed since it was loaded,
+        // the caller keeps its reference to parent then
+        int AddFSElement(const std::string& path, FSElementPtr&& ptr_in, int parent, 
+            unsigned long dropped, unsigned long reclaimed);
+        // put the element in a free slot of the shard, its mutex has to be held
+        int NewSlot(unsigned shard_idx, const std::string& path, FSElementPtr&& ptr_in, int parent);
+        // open the element at path again if it's already opened, -1 otherwise
+        int Acquire(const std::string& path);
+        // take another reference to an element the caller holds
+        void Retain(int idx);
+        // drop one reference, an element that is no longer opened is written back and its slot freed
+        // which releases its parent in turn
+        void Release(int idx);
+        // lock every shard, for the rare changes to paths of many opened elements
+        std::vector<std::unique_lock<std::mutex>> LockOpened();
+        // point the opened elements at and under old_path to where they were moved
+        void RenameOpened(const std::string& old_path, const std::string& new_path);
+        // detach the opened elements at and under a removed path, they can't be opened by it anymore
+        // only the removed element (its inode at block_num) and the ones opened through it are detached,
+        // not whatever has been added at the same path since
+        void DetachOpened(const std::string& path, unsigned int block_num);
+        // detach the element opened with its inode at block_num (by path or by handle) if there is one
+        // called by the reclaimer, so removed files opened by handle are caught as well
+        void DetachInode(unsigned int block_num);
+
+        // open the names in split_path from first on, starting at the opened directory cur_idx at new_path
+        // the walk takes over the caller's reference to cur_idx
+        int Walk(int cur_idx, std::string new_path, const std::vector<std::string>& split_path, size_t first);
+        // split path into the directory part (opened relative to dir_idx) and the name in it
+        // returns the opened directory or -1
+        int OpenParent(int dir_idx, const std::string& path, std::string& name);
+        // the parts of Add/Remove after the parent is opened, they close parent_idx
+        bool AddIn(int parent_idx, const std::string& path, const std::string& filename, 
+            ElementType t, int owner, int perissions);
+        bool RemoveIn(int parent_idx, const std::string& path, const std::string& filename);
 
         static std::vector<std::string> SplitPath(const std::string& path_str);
-        int GetIdx(const std::string& path);
+        // a name an entry can be found by again: not empty, no '/' and at most MaxNameLen long
+        static bool IsValidName(const std::string& name);
+        // resolve a name in the directory through the dentry cache, returns false if it doesn't exist
+        bool Lookup(const Directory* dir, const std::string& name, DentryCache::Dentry& d);
+        // replace the on-disk metadata of listed entries that are opened with what their elements hold
+        void OverlayOpened(std::vector<Directory::EntryInfo>& entries);
+        // periodically syncs opened elements while mounted with lazytime or delalloc
+        void SyncLoop();
 
     private:
         const std::string filename;
         Disk d;
         BlockManager bm;
-        std::vector<MasterFCB> opened;
-        mutable std::mutex mtx;
+        DentryCache dcache;
+        Reclaimer reclaimer;
+        std::array<Shard, NumShards> opened;
+        // the element opened with each inode block, detached elements aren't in it
+        // so an element is loaded once when it's opened by handle or by more than one path during a rename
+        // locked after the shards
+        std::mutex inodes_mtx;
+        std::unordered_map<unsigned int, OpenedInode> inodes;
+        // bumped whenever an element is taken out of inodes after being written back
+        std::atomic<unsigned long> num_dropped{ 0 };
         //std::mutex mtx;
-        std::string last_error;
+        // held while moving between directories, so concurrent moves can't create a cycle
+        std::mutex rename_mtx;
+        // every service thread serves one client, so errors are kept per thread
+        static thread_local std::string last_error;
+
+        /* lazytime sync thread */
+
+        std::thread sync_thread;
+        std::mutex sync_mtx;
+        std::condition_variable sync_cv;
+        bool mounted = true;
     };
 }
\ No newline at end of file
@@ -1,18 +1,65 @@
-#include <FSP.h>
-#include <iostream>
-
-int main(void)
-{
-	try
-	{
-		FSP fsp;
-		fsp.Run();
-	}
-	catch (std::exception& e)
-	{
-		//MessageBox(NULL, e.what(), "Standard Exception", MB_OK | MB_ICONEXCLAMATION);
-        std::cout << "Standare Exception\n" << e.what() << std::endl;
-	}
-
-	return 0;
+#include <FSP.h>
+#include <iostream>
+#include <sstream>
+#include <string.h>
+
+// parse a comma separated list of mount options (e.g. "noatime,lazytime")
+static bool ParseMountOptions(const std::string& str, MountOptions& opts)
+{
+	std::stringstream ss(str);
+	std::string opt;
+	while (std::getline(ss, opt, ','))
+	{
+		if (opt == "strictatime")
+			opts.atime = AtimeMode::Strict;
+		else if (opt == "relatime")
+			opts.atime = AtimeMode::Relatime;
+		else if (opt == "noatime")
+			opts.atime = AtimeMode::Noatime;
+		else if (opt == "lazytime")
+			opts.lazytime = true;
+		else if (opt == "nolazytime")
+			opts.lazytime = false;
+		else if (opt == "delalloc")
+			opts.delalloc = true;
+		else if (opt == "nodelalloc")
+			opts.delalloc = false;
+		else if (opt == "dirindex=hash")
+			opts.dir_format = DirFormat::Hash;
+		else if (opt == "dirindex=btree")
+			opts.dir_format = DirFormat::BTree;
+		else
+		{
+			std::cout << "Unknown mount option: " << opt << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	MountOptions opts;
+	// mount options are passed the same way as to mount(8): -o opt1,opt2
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-o") != 0 || i + 1 >= argc || !ParseMountOptions(argv[++i], opts))
+		{
+			std::cout << "Usage: " << argv[0] << " [-o strictatime|relatime|noatime,lazytime,delalloc,dirindex=hash|btree]" << std::endl;
+			return 1;
+		}
+	}
+
+	try
+	{
+		FSP fsp(opts);
+		fsp.Run();
+	}
+	catch (std::exception& e)
+	{
+		//MessageBox(NULL, e.what(), "Standard Exception", MB_OK | MB_ICONEXCLAMATION);
+        std::cout << "Standare Exception\n" << e.what() << std::endl;
+	}
+
+	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "RWLock.h"
+
+
+void RWLock::lock()
+{
+    writer_mtx.lock();
+    writer.store(true);
+    // readers that got in before the flag was set finish, everyone after it waits
+    std::unique_lock<std::mutex> lock(wait_mtx);
+    cv.wait(lock, [this](){ return NoReaders(); });
+}
+
+void RWLock::unlock()
+{
+    {
+        std::lock_guard<std::mutex> lock(wait_mtx);
+        writer.store(false);
+    }
+    cv.notify_all();
+    writer_mtx.unlock();
+}
+
+void RWLock::lock_shared()
+{
+    Slot& s = GetSlot();
+    while(true)
+    {
+        // no shared state is written on the fast path other than the thread's own slot
+        s.readers.fetch_add(1);
+        if(!writer.load())
+            return;
+
+        // a writer is waiting or writing, step back out of its way until it is done
+        if(s.readers.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> lock(wait_mtx);
+            cv.notify_all();
+        }
+        std::unique_lock<std::mutex> lock(wait_mtx);
+        cv.wait(lock, [this](){ return !writer.load(); });
+    }
+}
+
+void RWLock::unlock_shared()
+{
+    // the last reader out wakes up a writer waiting for it
+    if(GetSlot().readers.fetch_sub(1) == 1 && writer.load())
+    {
+        std::lock_guard<std::mutex> lock(wait_mtx);
+        cv.notify_all();
+    }
+}
+
+RWLock::Slot& RWLock::GetSlot()
+{
+    // a thread can move between cores while holding the lock, so the slot goes by thread instead
+    // threads are handed out slots in turn, which spreads them evenly
+    static std::atomic<unsigned int> next_idx{ 0 };
+    thread_local const unsigned int idx = next_idx++ % NumSlots;
+    return slots[idx];
+}
+
+bool RWLock::NoReaders() const
+{
+    for(const Slot& s : slots)
+    {
+        if(s.readers.load() != 0)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+// a readers-writer lock that prefers writers
+// readers count themselves in one of several slots (picked by thread) on separate cache lines,
+// so readers on different cores don't keep taking the same line away from each other
+// once a writer shows up new readers wait for it, so a steady stream of readers can't starve it
+// meets the SharedMutex requirements, so std::unique_lock and std::shared_lock can be used with it
+class RWLock
+{
+    static constexpr unsigned int NumSlots = 16;
+    struct alignas(64) Slot
+    {
+        std::atomic<int> readers{ 0 };
+    };
+public:
+    RWLock() = default;
+    RWLock(const RWLock&) = delete;
+    RWLock& operator=(const RWLock&) = delete;
+
+    void lock();
+    void unlock();
+    // a shared lock must be released by the thread that took it
+    void lock_shared();
+    void unlock_shared();
+
+private:
+    // the slot the calling thread counts itself in
+    Slot& GetSlot();
+    bool NoReaders() const;
+
+private:
+    Slot slots[NumSlots];
+    // set while a writer holds the lock or waits for the readers to leave
+    std::atomic<bool> writer{ false };
+    // only one writer at a time gets to set the flag
+    std::mutex writer_mtx;
+    // used to sleep on, readers wait for the writer to finish and the writer for the readers to leave
+    std::mutex wait_mtx;
+    std::condition_variable cv;
+};
@@ -0,0 +1,36 @@
+#include "RangeLock.h"
+
+void RangeLock::Lock(unsigned int begin, unsigned int end, bool exclusive)
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [&](){ return !Conflicts(begin, end, exclusive); });
+    held.insert({ begin, { end, exclusive } });
+}
+
+void RangeLock::Unlock(unsigned int begin, unsigned int end, bool exclusive)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto range = held.equal_range(begin);
+        for(auto it = range.first; it != range.second; ++it)
+        {
+            if(it->second.end == end && it->second.exclusive == exclusive)
+            {
+                held.erase(it);
+                break;
+            }
+        }
+    }
+    cv.notify_all();
+}
+
+bool RangeLock::Conflicts(unsigned int begin, unsigned int end, bool exclusive) const
+{
+    // only ranges that begin before this one ends can overlap it
+    for(auto it = held.begin(); it != held.end() && it->first < end; ++it)
+    {
+        if(it->second.end > begin && (exclusive || it->second.exclusive))
+            return true;
+    }
+    return false;
+}
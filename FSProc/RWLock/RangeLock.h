@@ -0,0 +1,35 @@
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+// locks ranges [begin, end) of something like a file, ranges that don't overlap can be locked at the same time
+// overlapping shared ranges don't exclude each other, an exclusive range excludes everything overlapping it
+class RangeLock
+{
+    struct Holder
+    {
+        unsigned int end;
+        bool exclusive;
+    };
+public:
+    RangeLock() = default;
+    RangeLock(const RangeLock&) = delete;
+    RangeLock& operator=(const RangeLock&) = delete;
+
+    // block until nothing conflicting with the range is held and then hold it
+    void Lock(unsigned int begin, unsigned int end, bool exclusive);
+    // release a range held with the same arguments
+    void Unlock(unsigned int begin, unsigned int end, bool exclusive);
+
+private:
+    bool Conflicts(unsigned int begin, unsigned int end, bool exclusive) const;
+
+private:
+    std::mutex mtx;
+    std::condition_variable cv;
+    // held ranges by where they begin
+    // only as many ranges are held as there are requests in flight, so they are simply checked in order
+    std::multimap<unsigned int, Holder> held;
+};
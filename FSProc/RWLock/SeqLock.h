@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+// holds a copy of a small value that readers can take without ever blocking or being blocked
+// a reader retries if the value changed while it was copying it (seqlock)
+// the value is kept in atomic words, so a copy racing with a Store is not a data race
+// Stores must not run concurrently with each other
+template<typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "only plain values can be copied word by word");
+    static constexpr size_t NumWords = (sizeof(T) + sizeof(unsigned long long) - 1) / sizeof(unsigned long long);
+public:
+    SeqLock() = default;
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    T Load() const
+    {
+        unsigned long long buf[NumWords];
+        while(true)
+        {
+            const unsigned int begin = seq.load(std::memory_order_acquire);
+            // odd while a Store is in progress
+            if(begin & 1)
+                continue;
+            for(size_t i = 0; i < NumWords; i++)
+                buf[i] = words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(seq.load(std::memory_order_relaxed) == begin)
+                break;
+        }
+        T value;
+        memcpy(&value, buf, sizeof(T));
+        return value;
+    }
+
+    void Store(const T& value)
+    {
+        unsigned long long buf[NumWords] = {};
+        memcpy(buf, &value, sizeof(T));
+        const unsigned int s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for(size_t i = 0; i < NumWords; i++)
+            words[i].store(buf[i], std::memory_order_relaxed);
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+private:
+    std::atomic<unsigned int> seq{ 0 };
+    std::atomic<unsigned long long> words[NumWords] = {};
+};
@@ -0,0 +1,116 @@
+#include "Reclaimer.h"
+using namespace FS;
+
+#include <Directory.h>
+
+Reclaimer::Reclaimer(BlockManager& bm, DentryCache& dcache, 
+    std::function<void(unsigned int)> on_reclaim, unsigned int num_workers)
+    :
+    bm(bm),
+    dcache(dcache),
+    on_reclaim(std::move(on_reclaim))
+{
+    for(unsigned int i = 0; i < num_workers; i++)
+        workers.emplace_back(&Reclaimer::Work, this);
+}
+
+Reclaimer::~Reclaimer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    for(auto& t : workers)
+        t.join();
+}
+
+void Reclaimer::Reclaim(unsigned int block_num, ElementType type)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        queue.push_back({ block_num, type });
+        reclaiming.insert(block_num);
+        num_pending++;
+    }
+    work_cv.notify_one();
+}
+
+void Reclaimer::Wait()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    idle_cv.wait(lock, [this](){ return num_pending == 0; });
+}
+
+bool Reclaimer::IsReclaiming(unsigned int block_num)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return reclaiming.count(block_num) != 0;
+}
+
+unsigned long Reclaimer::GetNumReclaimed()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return num_reclaimed;
+}
+
+void Reclaimer::Work()
+{
+    std::vector<unsigned int> batch;
+    // inode blocks of the elements whose blocks are in the batch
+    std::vector<unsigned int> batched;
+    std::unique_lock<std::mutex> lock(mtx);
+    while(true)
+    {
+        // the queue is drained before stopping, so nothing is left allocated on unmount
+        work_cv.wait(lock, [this](){ return stopping || !queue.empty(); });
+        if(queue.empty())
+            return;
+        const DentryCache::Dentry d = queue.front();
+        queue.pop_front();
+        lock.unlock();
+
+        FSElementPtr ptr = Directory::LoadEntry(bm, d.block_num, d.type);
+        if(d.type == ElementType::Directory)
+        {
+            // the children are queued for any worker to pick up
+            std::vector<DentryCache::Dentry> children;
+            auto dir_ptr = static_cast<Directory*>(ptr.get());
+            dir_ptr->ForEachChild(bm, [&](unsigned int block_num, ElementType type) {
+                children.push_back({ block_num, type });
+            });
+            // the inode block may be reused once it is freed
+            dcache.InvalidateDir(d.block_num);
+            if(!children.empty())
+            {
+                std::lock_guard<std::mutex> queue_lock(mtx);
+                queue.insert(queue.end(), children.begin(), children.end());
+                for(const auto& child : children)
+                    reclaiming.insert(child.block_num);
+                num_pending += children.size();
+            }
+            work_cv.notify_all();
+        }
+        if(on_reclaim)
+            on_reclaim(d.block_num);
+        ptr->CollectBlocks(bm, batch);
+        batched.push_back(d.block_num);
+
+        lock.lock();
+        // what was collected is freed once the batch is full or there is nothing else to do for now
+        if(batch.size() >= BatchSize || queue.empty())
+        {
+            lock.unlock();
+            bm.FreeBlocks(batch);
+            batch.clear();
+            lock.lock();
+            for(unsigned int block_num : batched)
+                reclaiming.erase(block_num);
+            num_pending -= batched.size();
+            num_reclaimed += batched.size();
+            batched.clear();
+            if(num_pending == 0)
+                idle_cv.notify_all();
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <BlockManager.h>
+#include <DentryCache.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace FS
+{
+    // frees removed elements in the background
+    // a removed directory is walked by several workers at once, each of them queueing the children it finds
+    // blocks are collected and freed in batches so the superblock isn't rewritten for every element
+    class Reclaimer
+    {
+        // blocks a worker collects before freeing them
+        static constexpr size_t BatchSize = 256;
+    public:
+        // on_reclaim is called with the inode block of every element right before its blocks are collected
+        Reclaimer(BlockManager& bm, DentryCache& dcache, 
+            std::function<void(unsigned int)> on_reclaim = nullptr, unsigned int num_workers = 4);
+        Reclaimer(const Reclaimer&) = delete;
+        Reclaimer& operator=(const Reclaimer&) = delete;
+        // frees everything still queued before returning
+        ~Reclaimer();
+
+        // free the element at block_num (and everything under it for a directory)
+        // it must not be reachable from any directory anymore
+        void Reclaim(unsigned int block_num, ElementType type);
+        // block until everything queued so far has been freed
+        void Wait();
+        // whether the element at block_num is queued or being freed
+        bool IsReclaiming(unsigned int block_num);
+        // the number of elements whose blocks have been freed so far
+        unsigned long GetNumReclaimed();
+
+    private:
+        void Work();
+
+    private:
+        BlockManager& bm;
+        DentryCache& dcache;
+        std::function<void(unsigned int)> on_reclaim;
+        std::mutex mtx;
+        // signalled when work is queued or the workers have to stop
+        std::condition_variable work_cv;
+        // signalled when nothing is queued or being worked on
+        std::condition_variable idle_cv;
+        std::deque<DentryCache::Dentry> queue;
+        // elements queued or taken by a worker whose blocks are not freed yet
+        size_t num_pending = 0;
+        unsigned long num_reclaimed = 0;
+        // inode blocks of the elements queued or taken by a worker whose blocks are not freed yet
+        std::unordered_set<unsigned int> reclaiming;
+        bool stopping = false;
+        std::vector<std::thread> workers;
+    };
+}
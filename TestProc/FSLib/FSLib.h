@@ -1,17 +1,70 @@
 #ifndef FSLIB_H
 #define FSLIB_H
 
+struct StatRecord;
+struct FileHandle;
+
 void FS_Init();
 void FS_Exit();
 
 int FS_Create(const char* path, char type, int permissions);
 int FS_Remove(const char* path);
 int FS_Open(const char* path);
+// create dst_path as a copy of the file at src_path, data is only copied once either side writes to it
+int FS_Clone(const char* src_path, const char* dst_path);
+// create count elements in the directory at dir_path with a single request
+// types[i] is 'D' or 'F', results[i] is set to 1 if names[i] was created, 0 if it exists or there was no room
+// and -1 if the name or type can't be used (empty, containing '/' or longer than 255) (results may be NULL)
+// returns the number of elements created or -1 if the directory can't be opened
+int FS_CreateMany(const char* dir_path, int count, const char** names, const char* types, 
+    const int* permissions, int* results);
+// move the file or directory at old_path to new_path without copying its data, fails if new_path exists
+int FS_Rename(const char* old_path, const char* new_path);
 int FS_Close(int fd);
+// open/create/remove path relative to the opened directory dirfd, only the components after it are looked up
+// (an absolute path ignores dirfd), list the directory itself by passing dirfd to FS_List/FS_ListPage
+int FS_OpenAt(int dirfd, const char* path);
+int FS_CreateAt(int dirfd, const char* path, char type, int permissions);
+int FS_RemoveAt(int dirfd, const char* path);
+// fill st (see FSIPC_Structures.h) with the size, type and timestamps of the element at path/opened as fd
+// without opening it or reading its data, returns 0 or -1
+int FS_Stat(const char* path, struct StatRecord* st);
+int FS_Fstat(int fd, struct StatRecord* st);
+// get a handle naming the file opened as fd that stays valid across renames, returns 0 or -1
+// FS_OpenByHandle opens the file again without looking up any path (the new descriptor has no path)
+// and fails once the file has been removed, even if another one has taken its place
+int FS_GetHandle(int fd, struct FileHandle* fh);
+int FS_OpenByHandle(const struct FileHandle* fh);
 
+// read/write at the descriptor's offset and advance it past what was transferred
 int FS_Read(int fd, char* buf, int size);
 int FS_Write(int fd, char* buf, int size);
+// read/write at offset, the descriptor's offset is left alone
+int FS_PRead(int fd, char* buf, int size, long long offset);
+int FS_PWrite(int fd, const char* buf, int size, long long offset);
+// write all of buf at the end of the file, appends from several clients never overlap
+// the descriptor's offset is left past the data, returns the offset the data was written at or -1
+int FS_Append(int fd, const char* buf, int size);
+// move the descriptor's offset relative to whence (SEEK_SET, SEEK_CUR or SEEK_END)
+// returns the new offset or -1
+long long FS_Seek(int fd, long long offset, int whence);
 int FS_List(int fd, char* buf, int max_size);
+// fill buf with a ListPlusRecord (see FSIPC_Structures.h) for every entry that fits
+// returns the number of bytes filled
+int FS_ListPlus(int fd, char* buf, int max_size);
+// fill buf with the next page of ListPlusRecords, starting at *cookie (0 for the first page)
+// *cookie is advanced past the page, returns the number of bytes filled (0 at the end),
+// -1 if fd isn't an opened directory, -2 if the directory changed layout since the cookie was handed out
+// (start over from cookie 0) or, if not even the next record fits in max_size, minus the size it needs
+int FS_ListPage(int fd, long long* cookie, char* buf, int max_size);
+// offset of the next data/hole at or after offset, -1 if there is none
+int FS_SeekData(int fd, int offset);
+int FS_SeekHole(int fd, int offset);
+// shrink/grow a file, or reserve space for [offset, offset + size) ahead of writing it
+int FS_Truncate(int fd, int size);
+int FS_Preallocate(int fd, int offset, int size);
+// copy the message of the last failed call made by this client into buf
+// returns its length (without the terminating null)
 int FS_GetErrorMsg(char* buf, int max_size);
 
 #endif
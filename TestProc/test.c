@@ -3,12 +3,15 @@
 #include <sys/msg.h>
 #include <unistd.h>
 #include <FSLib.h>
+#include <FSIPC_Structures.h>
 #include <pthread.h>
 #include <string.h>
 
 
 void Create();
 void Remove();
+void Move();
+void Stat();
 void Ls();
 void Read();
 void Write();
@@ -42,6 +45,14 @@ int main(void)
         {
             Remove();
         }
+        else if(strcmp(com, "mv") == 0)
+        {
+            Move();
+        }
+        else if(strcmp(com, "stat") == 0)
+        {
+            Stat();
+        }
         else if(strcmp(com, "exit") == 0)
         {
             break;
@@ -66,6 +77,28 @@ void Remove()
     FS_Remove(path);
 }
 
+void Move()
+{
+    char old_path[255], new_path[255];
+    scanf(" %s %s", old_path, new_path);
+    if(FS_Rename(old_path, new_path) != 1)
+        printf("Error in FS_Rename\n");
+}
+
+void Stat()
+{
+    char path[255];
+    scanf(" %s", path);
+    struct StatRecord st;
+    if(FS_Stat(path, &st) != 0)
+    {
+        printf("Error in FS_Stat\n");
+        return;
+    }
+    printf("[%c] size %u owner %d permissions %o modified %lld\n", 
+        st.type, st.size, st.owner, st.permissions, st.modified);
+}
+
 void Ls()
 {
     char path[255], buf[256];
@@ -76,9 +109,21 @@ void Ls()
         printf("Error in FS_Open\n");
         return;
     }
-    FS_List(fd, buf, 255);
+    long long cookie = 0;
+    int size;
+    while((size = FS_ListPage(fd, &cookie, buf, sizeof(buf))) > 0)
+    {
+        for(int pos = 0; pos < size; )
+        {
+            struct ListPlusRecord rec;
+            memcpy(&rec, buf + pos, sizeof(rec));
+            printf("[%c]%.*s\n", rec.type, rec.name_len, buf + pos + sizeof(rec));
+            pos += rec.rec_len;
+        }
+    }
+    if(size == -1)
+        printf("Error in FS_ListPage\n");
     FS_Close(fd);
-    printf("%s\n", buf);
 }
 
 void Read()